@@ -1,7 +1,10 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
+#include "AnswerVector.hpp"
 
 class AnswerKey {
 public:
@@ -9,6 +12,60 @@ public:
         std::string subject;
         int questionNumber; 
         char correctAnswer;
+        std::string alsoAccepted = {};   // further options that also score
+        bool cancelled = false;          // counts as correct for everyone
+    };
+
+    // Exam-wide scoring rules: a subject's net is
+    // weight * (correct - penalty * wrong).
+    struct ScoringRules {
+        double penalty = 1.0 / 3.0;
+        std::map<std::string, double> subjectPenalty;
+        std::map<std::string, double> subjectWeight;
+
+        double penaltyFor(const std::string& subject) const;
+        double weightFor(const std::string& subject) const;
+    };
+
+    // One booklet's key and rules flattened at load: every question of every
+    // subject in one array, so scoring is a branch-free pass per subject.
+    struct CompiledKey {
+        struct Subject {
+            std::string name;
+            int first = 0;
+            int count = 0;
+            double weight = 1.0;
+            double penalty = 1.0 / 3.0;
+
+            double net(int correct, int wrong) const { return weight * (correct - penalty * wrong); }
+        };
+
+        std::vector<Subject> subjects;    // by subject name
+        std::vector<uint32_t> accept;     // bit k: option 'A' + k scores
+        std::vector<uint8_t> cancelled;   // 1: correct for everyone
+
+        int subjectIndex(const std::string& name) const;
+
+        bool scores(int q, uint8_t code) const {
+            return cancelled[q] || (AnswerVector::isAnswer(code) && code < 32 && ((accept[q] >> code) & 1u));
+        }
+
+        // Correct and wrong counts of one subject's answer row; the rest are empty.
+        void count(const Subject& s, const AnswerVector& row, int& correct, int& wrong) const {
+            const uint32_t* acc = accept.data() + s.first;
+            const uint8_t* can = cancelled.data() + s.first;
+            const int n = s.count < AnswerVector::kCapacity ? s.count : AnswerVector::kCapacity;
+            int c = 0, w = 0;
+            for (int q = 0; q < n; ++q) {
+                const uint32_t code = row.codes[q];
+                const uint32_t answered = code < AnswerVector::Blank;
+                const uint32_t hit = (acc[q] >> (code & 31u)) & answered;
+                c += can[q] | hit;
+                w += (can[q] ^ 1u) & answered & (hit ^ 1u);
+            }
+            correct = c;
+            wrong = w;
+        }
     };
 
     struct SubjectStat {
@@ -24,12 +81,72 @@ public:
         int totalWrong = 0;
         int totalEmpty = 0;
         double totalScore = 0.0;
+        char booklet = 0;               // booklet whose key was used
+        bool bookletMissing = false;    // several booklets, sheet's not read
         std::map<std::string, SubjectStat> subjectDetails;
     };
 
+    // Replaces every booklet with a single key (booklet 'A').
     void loadAnswerKey(const std::vector<QuestionAnswer>& keys);
-    ScoreResult calculateScore(const std::map<std::string, std::string>& studentAnswersCsv);
+    // Adds or replaces the key of one booklet ('A'..'Z').
+    void loadBooklet(char booklet, const std::vector<QuestionAnswer>& keys);
+    // Recompiles every booklet under new rules.
+    void setRules(const ScoringRules& rules);
+    const ScoringRules& rules() const { return rules_; }
+
+    // Text key file, one statement per line, '#' starts a comment:
+    //   kitapcik X             following keys belong to booklet X
+    //   <ders> <cevaplar>      answers in order; [AC] accepts A or C
+    //   iptal <ders> 3 7 ...   cancelled questions of the current booklet
+    //   ceza [ders] N          wrong answers cost 1/N (0: no penalty)
+    //   agirlik <ders> W       subject net is multiplied by W
+    //   kitapcik_alani x y w h page rectangle (fractions) of the booklet bubbles
+    // Keys before any "kitapcik" belong to 'A'.
+    bool loadFromFile(const std::string& path, std::string* error = nullptr);
+
+    // booklet 0 or one without a key scores against the default booklet.
+    ScoreResult calculateScore(const std::map<std::string, AnswerVector>& studentAnswers,
+                               char booklet = 0) const;
+
+    const CompiledKey& compiled(char booklet = 0) const;
+
+    // Changes whenever any booklet's compiled key or rules change.
+    uint64_t fingerprint() const;
+
+    // Loaded booklet letters in load order; the first is the default.
+    std::string booklets() const;
+    char defaultBooklet() const { return booklets_.empty() ? 'A' : booklets_.front().id; }
+    bool hasBooklet(char booklet) const { return slot(booklet) >= 0; }
+
+    // Where the form prints its booklet-type bubbles ("kitapcik_alani":
+    // x, y, w, h as page fractions), or nullptr if the key file gives none;
+    // the reader then never reads a booklet and the default one scores.
+    const float* bookletRegion() const { return hasBookletRegion_ ? bookletRegion_.data() : nullptr; }
+
+    // Booklet letter read into the identity fields ("kitapcik"), or 0.
+    static char bookletFromFields(const std::map<std::string, std::string>& fields);
 
 private:
-    std::map<std::string, std::map<int, char>> keyMap_;
-};
\ No newline at end of file
+    struct Booklet {
+        char id;
+        std::vector<QuestionAnswer> source;
+        CompiledKey compiled;
+    };
+
+    ScoringRules rules_;
+    std::vector<Booklet> booklets_;
+    std::array<float, 4> bookletRegion_{};
+    bool hasBookletRegion_ = false;
+    std::array<int, 26> index_ = filledIndex();   // letter -> booklets_ slot
+
+    static std::array<int, 26> filledIndex() {
+        std::array<int, 26> a;
+        a.fill(-1);
+        return a;
+    }
+
+    int slot(char booklet) const;
+    const Booklet* resolve(char booklet, ScoreResult& res) const;
+    void compile(Booklet& b) const;
+    static void finishSubject(ScoreResult& res, const std::string& subject, SubjectStat& stat);
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Fixed-capacity answer row for one subject: one byte per question.
+// Codes below Blank are option indices ('A' + code); the remaining codes
+// are reads that never count as an answer.
+struct AnswerVector {
+    static constexpr int kCapacity = 64;
+
+    enum Code : uint8_t {
+        Blank     = 0xF0,
+        Multi     = 0xF1,
+        Uncertain = 0xF2
+    };
+
+    std::array<uint8_t, kCapacity> codes;
+    int count = 0;
+
+    AnswerVector() { codes.fill(Blank); }
+
+    int size() const { return count; }
+    void clear() { codes.fill(Blank); count = 0; }
+
+    void push(uint8_t code) {
+        if (count < kCapacity) codes[count++] = code;
+    }
+
+    void set(int i, uint8_t code) {
+        if (i < 0 || i >= kCapacity) return;
+        codes[i] = code;
+        if (i >= count) count = i + 1;
+    }
+
+    uint8_t operator[](int i) const {
+        return (i >= 0 && i < count) ? codes[i] : static_cast<uint8_t>(Blank);
+    }
+
+    static bool isAnswer(uint8_t code) { return code < Blank; }
+
+    static char toChar(uint8_t code) {
+        if (isAnswer(code)) return static_cast<char>('A' + code);
+        if (code == Multi) return 'X';
+        if (code == Uncertain) return '?';
+        return '-';
+    }
+
+    static uint8_t fromChar(char c) {
+        if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        if (c == 'X') return Multi;
+        if (c == '?') return Uncertain;
+        if (c >= 'A' && c <= 'Z') return static_cast<uint8_t>(c - 'A');
+        return Blank;
+    }
+
+    // CSV form ("A,-,X,...") for export only; scoring and overlays use codes.
+    std::string toCsv() const {
+        std::string out;
+        out.reserve(count * 2);
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) out.push_back(',');
+            out.push_back(toChar(codes[i]));
+        }
+        return out;
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <array>
+
+namespace core {
+
+// Hands-free capture for the kiosk: fires once when the corner markers have
+// stopped moving and the bubble read has converged, then stays disarmed
+// until the sheet has left the frame.
+class AutoCapture {
+public:
+    enum class State {
+        Armed,      // waiting for a steady sheet
+        Captured    // result taken, waiting for the sheet to be removed
+    };
+
+    static constexpr int kMaxWindow = 30;
+
+    AutoCapture(int window = 10, double maxJitterPx = 3.0, int removalFrames = 8);
+
+    // Feed one frame. Returns true exactly once per sheet, on the frame the
+    // capture should be taken.
+    bool update(bool paperOk,
+                const std::array<cv::Point2f, 4>& markers,
+                bool readStable);
+
+    void reset();
+
+    State state() const { return state_; }
+    bool isHolding() const { return state_ == State::Captured; }
+    double lastJitter() const { return lastJitter_; }
+    int steadyFrames() const { return filled_; }
+    int window() const { return window_; }
+
+private:
+    int window_;
+    double maxJitterPx_;
+    int removalFrames_;
+
+    State state_ = State::Armed;
+    std::array<std::array<cv::Point2f, 4>, kMaxWindow> ring_{};
+    int head_ = 0;
+    int filled_ = 0;
+    int missing_ = 0;
+    double lastJitter_ = 0.0;
+
+    double windowJitter() const;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PerspectiveCorrector.hpp"
+#include "AnswerKey.hpp"
+#include "FillTensorFile.hpp"
+#include "CvBackend.hpp"
+
+namespace core {
+
+class SheetPipeline;
+
+struct BatchOptions {
+    std::vector<std::string> inputs;    // image paths, in output order
+    std::string outPath = "results.jsonl";
+    int prefetch = 4;
+    double fillThreshold = 0.40;
+    bool regionWarp = false;            // warp only the read regions
+
+    // Sub-range of inputs to score; `index` in the output stays global.
+    size_t begin = 0;
+    size_t end = static_cast<size_t>(-1);
+    bool append = false;
+    bool quiet = false;
+
+    // Resumable runs: every N sheets the output is flushed and
+    // <out>.ckpt records (next input index, output byte offset). 0 = off.
+    int checkpointEvery = 64;
+
+    // Dense per-bubble fill ratios (FillTensorFile), indexed like `index`
+    // in the output; empty path = not written.
+    std::string fillsPath;
+
+    // Content-hash read cache (ResultCache); empty path = no cache.
+    std::string cachePath;
+    size_t cacheBytes = 256u * 1024u * 1024u;
+
+    // Multi-process mode (ShardedBatchRunner).
+    int workers = 1;
+    size_t shardSize = 0;   // 0 = choose from input count and workers
+
+    // OpenCV threads of each scoring process; cvThreads 0 = the cores are
+    // split evenly between the worker processes.
+    CvBudget cv;
+};
+
+// Headless scoring of an image list into a JSON-lines result file
+// (one line per input, in input order).
+class BatchRunner {
+public:
+    BatchRunner(const PerspectiveCorrector& corrector,
+                const AnswerKey& answerKey,
+                BatchOptions options);
+
+    int run();
+
+    // Opens (or creates) opt.fillsPath for all of opt.inputs, laid out by the
+    // regions pipeline's detector reads; see FillTensorFile::open for keep.
+    static bool openFills(FillTensorFile& fills, const BatchOptions& opt,
+                          const SheetPipeline& pipeline, bool keep);
+
+    // Directories expand to their image files (sorted), *.txt / *.lst files
+    // to one path per line; anything else is taken as an image path.
+    static std::vector<std::string> expandInputs(const std::vector<std::string>& args);
+
+private:
+    struct Checkpoint {
+        uint64_t runHash = 0;       // inputs in order + output-affecting settings
+        size_t inputCount = 0;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t next = 0;
+        unsigned long long offset = 0;
+    };
+
+    const PerspectiveCorrector& corrector_;
+    const AnswerKey& answerKey_;
+    BatchOptions opt_;
+
+    std::string checkpointPath() const;
+    uint64_t runFingerprint(const SheetPipeline& pipeline) const;
+    bool loadCheckpoint(Checkpoint& ck) const;
+    bool saveCheckpoint(const Checkpoint& ck) const;
+};
+
+}
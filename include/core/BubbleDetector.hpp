@@ -2,8 +2,8 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <string>
-#include <deque>
 #include <map>
+#include "AnswerVector.hpp"
 
 struct BubbleResult {
     int questionNumber;
@@ -51,6 +51,29 @@ public:
         char firstLabel,
         cv::Mat* debugVis = nullptr);
 
+    // Same grid read, but fill ratios are averaged over the last historySize_
+    // pushes for historyKey (one key per region) when temporal smoothing is on.
+    // cellFillRatios, if given, receives those ratios row-major.
+    std::vector<BubbleResult> detectBubblesSmoothed(
+        const cv::Mat& roiGray,
+        int rows,
+        int cols,
+        int startQuestionNumber,
+        char firstLabel,
+        int historyKey,
+        std::vector<float>* cellFillRatios = nullptr);
+
+    // As detectBubblesSmoothed, for a ROI that is already binarized (ink =
+    // 255, before opening), e.g. by core::LocalMeanThreshold.
+    std::vector<BubbleResult> detectBubblesSmoothedBinary(
+        const cv::Mat& roiBin,
+        int rows,
+        int cols,
+        int startQuestionNumber,
+        char firstLabel,
+        int historyKey,
+        std::vector<float>* cellFillRatios = nullptr);
+
     void drawBubbleDebug(
         cv::Mat& debugImg,
         const cv::Rect& roi,
@@ -64,6 +87,20 @@ public:
     void setDebugMode(bool b) { debugMode_ = b; }
     cv::Mat getLastDebugVisualization() const { return debugVis_; }
 
+    void setTemporalSmoothing(bool enabled, int historySize);
+    bool isTemporalSmoothingEnabled() const { return temporalSmoothingEnabled_; }
+    void resetHistory();
+    bool isHistoryStable(int historyKey) const;
+
+    // Feeds back the answers actually decoded from the last read of
+    // historyKey (after the applied mark threshold); the key counts as
+    // stable only while these stay the same from frame to frame.
+    void commitDecoded(int historyKey, const AnswerVector& answers);
+
+    // Creates the history slot for a key up front. Reads for distinct keys
+    // may then run concurrently; creating slots is not thread-safe.
+    void prepareHistory(int historyKey);
+
 private:
     double fillThreshold_;
     double minSeparation_ = 10.0;
@@ -71,20 +108,37 @@ private:
     int historySize_ = 5;
     bool debugMode_ = false;
     
+    // Ring buffer of per-cell fill ratios for one region. Buffers are sized
+    // once per (rows, cols, historySize_) and reused on every push.
+    struct FillHistory {
+        int rows = 0;
+        int cols = 0;
+        int head = 0;
+        int filled = 0;
+        int stableFrames = 0;
+        double maxStdDev = 1.0;
+        std::vector<float> ring;
+        std::vector<double> sum;
+        std::vector<double> sumSq;
+        AnswerVector lastDecoded;
+    };
+
     cv::Mat debugVis_;
-    std::map<int, std::deque<std::string>> answerHistory_;
+    std::map<int, FillHistory> answerHistory_;
     std::vector<BubbleContour> lastDetectedBubbles_;
 
+    void pushHistory(FillHistory& h, std::vector<double>& ratios, int rows, int cols);
+
     double calculateFillRatio(const cv::Mat& bubbleImg);
     
     std::vector<BubbleResult> detectBubblesGridCore(
-        const cv::Mat& roiGray,
+        const cv::Mat& roiBin,
         int rows,
         int cols,
         int startQuestionNumber,
         char firstLabel,
-        bool applySmoothing,
-        std::vector<std::vector<double>>* cellFillRatios);
+        int historyKey,
+        std::vector<float>* cellFillRatios);
 
     cv::Rect refineBubbleRect(const cv::Mat& cellPatch, const cv::Rect& initialRect);
 };
\ No newline at end of file
@@ -8,26 +8,106 @@ namespace core {
 struct CornerResult {
     bool paper_ok = false;
     cv::Mat warped_gray;
+    cv::Mat H;                  // source image -> page (outW x outH)
+    cv::Mat source_gray;        // grayscale input the markers were found in
     cv::Mat debug_bgr;
     std::array<cv::Point2f,4> markers_orig{{{-1,-1},{-1,-1},{-1,-1},{-1,-1}}};
+
+    // Homography sanity, filled whenever four markers were found.
+    // quality is the worst of the individual checks, 0 (unusable) .. 1.
+    double quality = 0.0;
+    double side_ratio = 0.0;        // shorter/longer of opposite page sides
+    double aspect_ratio = 0.0;      // measured vs. expected page aspect
+    double min_angle = 0.0;         // quad interior angles, degrees
+    double max_angle = 0.0;
+    double marker_size_cv = 0.0;    // marker size spread after projection
+
+    int orientation = 0;            // quarter turns folded into H (0..3)
+    double orientation_margin = 0.0;// layout score gap behind the 0/180 choice
+
+    int contour_count = 0;          // outer contours in the thresholded frame
+    int candidate_count = 0;        // of those, square-marker candidates
 };
 
 class CornerFinder {
 public:
     CornerFinder(int outW, int outH) : outW_(outW), outH_(outH) {}
     
-    CornerResult processFrame(const cv::Mat& bgr, bool debug_on) const;
+    // With warp_page off only the homography is returned, for callers that
+    // warp just the parts of the page they read.
+    CornerResult processFrame(const cv::Mat& bgr, bool debug_on, bool warp_page = true) const;
+
+    // Page rectangles (outW x outH coordinates) that carry printed content.
+    // When set, upside-down sheets are detected from this layout; otherwise
+    // only portrait vs. sideways is decided, from the marker quad.
+    void setOrientationLayout(const std::vector<cv::Rect>& pageRects);
+    bool hasOrientationLayout() const { return !layoutMask_.empty(); }
+
+    // Frames scoring below this are rejected before any warp.
+    void setMinQuality(double q) { minQuality_ = q; }
+    double minQuality() const { return minQuality_; }
 
 private:
+    using Quad = std::array<cv::Point2f,4>;
+
+    // Contours that pass the marker filters, as parallel arrays indexed by
+    // candidate; `contour` is the index into the findContours output.
+    struct Candidates {
+        std::vector<int> contour;
+        std::vector<float> area;
+        std::vector<cv::Rect> box;
+        std::vector<float> extent;
+        std::vector<float> solidity;
+        std::vector<cv::Point2f> centroid;
+
+        size_t size() const { return contour.size(); }
+        void clear() {
+            contour.clear(); area.clear(); box.clear();
+            extent.clear(); solidity.clear(); centroid.clear();
+        }
+    };
+
+    // Cheapest tests first: bounding box size and aspect, then moments
+    // (area and centroid in one pass), extent, and the hull last.
+    void collectCandidates(const std::vector<std::vector<cv::Point>>& contours,
+                           Candidates& out) const;
+
+    // Picks the four candidates (unordered) that best form a page: convex,
+    // expected aspect, sane angles, similar marker sizes.
+    bool selectMarkerSet(const Candidates& cand, cv::Size frame, std::array<int,4>& pick) const;
+
     bool findCornerSquares(const cv::Mat& gray, 
                            std::vector<cv::Point2f>& corners, 
+                           std::vector<Quad>& quads,
+                           CornerResult& R,
                            cv::Mat* dbg) const;
+
+    // Subpixel marker centre (diagonal intersection of the refined square
+    // corners); falls back to the contour centroid.
+    cv::Point2f refineMarker(const cv::Mat& gray,
+                             const std::vector<cv::Point>& contour,
+                             cv::Point2f centroid,
+                             Quad& quad) const;
+
+    static std::vector<cv::Point2f> rotateOrder(const std::vector<cv::Point2f>& imageOrder, int turns);
+    int detectOrientation(const cv::Mat& gray, const std::vector<cv::Point2f>& imageOrder,
+                          double* margin) const;
+    double layoutScore(const cv::Mat& gray, const std::vector<cv::Point2f>& pageOrder) const;
+
+    void scoreHomography(const std::vector<cv::Point2f>& corners,
+                         const std::vector<Quad>& quads,
+                         CornerResult& R) const;
     
     std::vector<cv::Point2f> orderTLTRBRBL(const std::vector<cv::Point2f>& pts, 
                                            cv::Point2f C) const;
 
 private:
     int outW_, outH_;
+    double minQuality_ = 0.3;
+
+    static constexpr int kLayoutScale = 4;
+    cv::Mat layoutMask_;
+    cv::Mat layoutMaskInv_;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+namespace core {
+
+// OpenCV picks its own parallel backend thread count and may route work to
+// OpenCL; both are process-wide. The pipeline sets them explicitly instead,
+// so OpenCV's internal threads do not compete with our sheet-level workers
+// and latency does not depend on what OpenCV detected at start-up.
+struct CvBudget {
+    int cvThreads = 0;      // OpenCV threads in this process; 0 = all cores
+    // Per-stage overrides of cvThreads (0 = unchanged). Only for processes
+    // with one sheet in flight: the setting is global to the process.
+    int warpThreads = 0;
+    int readThreads = 0;
+    bool useOpenCL = false;
+};
+
+int cpuCount();
+
+// OpenCV threads for each of `workers` sheet workers. Separate processes
+// split the cores between them; threads of one process share OpenCV's
+// single pool, so with more than one of them OpenCV runs sequentially.
+int autoCvThreads(int workers, bool sharedProcess);
+
+// Applies the thread count and the OpenCL switch to this process.
+void applyCvBudget(const CvBudget& budget);
+
+// Sets OpenCV's thread count for one stage and restores it on scope exit;
+// n <= 0 leaves it alone.
+class ScopedCvThreads {
+public:
+    explicit ScopedCvThreads(int n);
+    ~ScopedCvThreads();
+
+    ScopedCvThreads(const ScopedCvThreads&) = delete;
+    ScopedCvThreads& operator=(const ScopedCvThreads&) = delete;
+
+private:
+    int saved_ = -1;
+};
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "AnswerKey.hpp"
+#include "AnswerVector.hpp"
+
+namespace core {
+
+// Streaming item analysis over scored sheets. Memory is fixed by the answer
+// key (one small counter block per question and per subject), not by the
+// number of sheets, and partial aggregates from parallel workers merge by
+// addition.
+//
+// Per question: option distribution, difficulty (share correct) and
+// discrimination as the point-biserial correlation between answering it
+// correctly and the sheet's total net, both under the key's scoring rules. Per subject and overall: net mean,
+// spread and range, and correct/wrong/empty totals.
+class ExamStats {
+public:
+    static constexpr int kOptions = 8;   // A..H; anything beyond counts as other
+
+    // Statistics of one booklet's key (0 = the key's default booklet).
+    explicit ExamStats(const AnswerKey& key, char booklet = 0);
+
+    char booklet() const { return booklet_; }
+
+    int subjectCount() const { return static_cast<int>(subjects_.size()); }
+    int subjectIndex(const std::string& name) const;   // -1 if not in the key
+
+    // One sheet. bySubject is indexed like subjectIndex(); missing subjects
+    // may be left empty (all blank).
+    void add(const std::vector<AnswerVector>& bySubject);
+    void add(const std::map<std::string, AnswerVector>& answers);
+    void addUnread() { unread_++; }
+
+    // Other must come from the same answer key.
+    void merge(const ExamStats& other);
+    void clear();   // zero all counters, keep the key
+
+    uint64_t sheets() const { return sheets_; }
+    uint64_t unread() const { return unread_; }
+
+    nlohmann::json toJson() const;
+
+    // Aggregates JSON-lines results (omr --batch output) on `threads`
+    // threads. Each sheet goes to the entry of its "booklet", or to out[0]
+    // when none matches. Returns the number of lines that could not be parsed.
+    static size_t addResultFiles(const std::vector<std::string>& paths, int threads,
+                                 std::vector<ExamStats>& out);
+
+private:
+    struct Item {
+        uint32_t accept = 0;        // scoring options, as in AnswerKey::CompiledKey
+        bool cancelled = false;
+        std::array<uint64_t, kOptions> options{};
+        uint64_t other = 0;
+        uint64_t blank = 0;
+        uint64_t multi = 0;
+        uint64_t uncertain = 0;
+        uint64_t correct = 0;
+        double totalWhenCorrect = 0.0;
+    };
+
+    struct Moments {
+        uint64_t n = 0;
+        double sum = 0.0;
+        double sumSq = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+
+        void add(double v);
+        void merge(const Moments& o);
+        double mean() const { return n ? sum / n : 0.0; }
+        double stddev() const;
+    };
+
+    struct Subject {
+        std::string name;
+        size_t firstItem = 0;
+        int questions = 0;
+        AnswerKey::CompiledKey::Subject rule;
+        Moments net;
+        uint64_t correct = 0;
+        uint64_t wrong = 0;
+        uint64_t empty = 0;
+    };
+
+    static bool scores(const Item& item, uint8_t code) {
+        return item.cancelled || (AnswerVector::isAnswer(code) && code < 32 && ((item.accept >> code) & 1u));
+    }
+
+    char booklet_ = 0;
+    std::vector<Subject> subjects_;
+    std::vector<Item> items_;
+    Moments total_;
+    uint64_t sheets_ = 0;
+    uint64_t unread_ = 0;
+};
+
+}
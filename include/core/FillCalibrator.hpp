@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace core {
+
+struct FillSplit {
+    bool ok = false;            // two well separated classes were found
+    double threshold = 0.0;     // marked iff ratio >= threshold
+    double unmarkedMean = 0.0;
+    double markedMean = 0.0;
+    int marked = 0;             // cells at or above threshold
+};
+
+// Per-sheet two-class split of bubble fill ratios. Ratios are binned as they
+// are added (one pass, no copies); split() then clusters the bins, using
+// per-bin sums so the class means are exact.
+class FillCalibrator {
+public:
+    static constexpr int kBins = 100;
+
+    void add(const float* ratios, size_t n);
+    void add(const std::vector<float>& ratios) { add(ratios.data(), ratios.size()); }
+    void reset();
+
+    size_t count() const { return count_; }
+
+    // seed is the prior cut the clustering starts from. Not ok when the page
+    // gives no evidence of two classes (blank sheet, all cells alike): both
+    // must be non-empty and their means at least minSeparation apart.
+    FillSplit split(double seed, double minSeparation) const;
+
+private:
+    std::array<uint32_t, kBins> hist_{};
+    std::array<double, kBins> sum_{};
+    size_t count_ = 0;
+};
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedImageSource.hpp"
+
+namespace core {
+
+// Dense per-bubble measurements of a batch, for offline analytics: one
+// fixed-size record per input index holding every cell's fill ratio as a
+// uint8 (ratio * 255), so the body is a sheets x cells matrix that can be
+// memory-mapped as is.
+//
+// Layout (little-endian):
+//   Header (64 bytes), then the region table: per region uint16 rows,
+//   uint16 cols, uint8 name length, name bytes; zero padding to headerBytes.
+//   Record i at headerBytes + i * recordBytes: uint8 status, uint8 answer
+//   threshold (* 255), uint8 flags (bit 0: threshold calibrated), uint8
+//   orientation (quarter turns), then cellsPerSheet uint8 fill ratios, region
+//   by region, each row-major.
+//
+// Records are written in place through a shared mapping, so separate
+// processes may fill disjoint index ranges of the same file.
+class FillTensorFile {
+public:
+    struct Region {
+        std::string name;
+        int rows = 0;
+        int cols = 0;
+    };
+
+    enum Status : uint8_t {
+        Empty    = 0,   // never written (not reached, or the worker died)
+        Measured = 1,
+        Failed   = 2,   // no paper / decode error; cells are zero
+        Cached   = 3    // answered from the read cache; cells are zero
+    };
+
+    // Opens or creates the file for sheetCount inputs. With keep, an existing
+    // file with the same layout and count keeps its records (resumed runs);
+    // otherwise every record is reset to Empty.
+    bool open(const std::string& path, size_t sheetCount, const std::vector<Region>& layout,
+              bool keep);
+    void close() { file_.close(); }
+    bool isOpen() const { return file_.isOpen(); }
+
+    size_t cellsPerSheet() const { return cells_; }
+
+    // cells must hold cellsPerSheet() ratios (fewer are zero-padded).
+    void write(size_t index, Status status, const std::vector<float>& cells,
+               double answerThreshold = 0.0, bool calibrated = false, int orientation = 0);
+
+private:
+    struct Header;
+
+    MappedFile file_;
+    size_t sheets_ = 0;
+    size_t cells_ = 0;
+    size_t headerBytes_ = 0;
+    size_t recordBytes_ = 0;
+};
+
+}
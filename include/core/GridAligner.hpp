@@ -0,0 +1,39 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace core {
+
+// Snaps a region's equal-division bubble lattice to the bubbles actually
+// printed on the page. Row and column intensity profiles of the area around
+// the nominal rectangle are taken once (cv::reduce); the lattice offset and
+// pitch along each axis are then chosen to put ink at the cell centres and
+// paper at the cell boundaries, each candidate scored in O(cells) from
+// prefix sums.
+// Stateless; safe to call concurrently.
+class GridAligner {
+public:
+    // maxShift: largest lattice shift, as a fraction of the cell pitch.
+    // maxScale: largest pitch change, as a fraction of the nominal pitch.
+    explicit GridAligner(double maxShift = 0.4, double maxScale = 0.05)
+        : maxShift_(maxShift), maxScale_(maxScale) {}
+
+    // Page area the profiles may look at for a nominal rectangle.
+    cv::Rect searchArea(const cv::Rect& nominal, int rows, int cols, const cv::Size& page) const;
+
+    // Aligned rectangle for rows x cols cells; the nominal one when the
+    // profiles show no clearly better lattice (e.g. nothing printed there).
+    cv::Rect align(const cv::Mat& gray, const cv::Rect& nominal, int rows, int cols) const;
+
+private:
+    double maxShift_;
+    double maxScale_;
+
+    // Best (start, length) of `cells` cells along one axis; prefix holds
+    // cumulative profile sums, depth the pixels summed per profile entry.
+    void alignAxis(const std::vector<int64_t>& prefix, double depth, int cells,
+                   int& start, int& length) const;
+};
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+namespace core {
+
+// Per-frame work planner for the live camera loop. Every frame gets the
+// corner search (preview); the page warp and the full bubble read run only
+// when the time they cost fits in what the frame budget has saved up, so
+// the display keeps pace with the camera and reads happen as often as the
+// machine allows.
+//
+// Stage costs are running averages of what record() reports; the budget is
+// one camera frame interval per frame. A read is forced after maxSkip
+// frames so even an overloaded machine keeps reading.
+class LiveScheduler {
+public:
+    enum class Stage {
+        Corners,    // marker search only
+        Warp,       // plus the page warp, no read
+        Read        // plus the full read
+    };
+
+    explicit LiveScheduler(double frameMs = 1000.0 / 30.0, int maxSkip = 30);
+
+    void setFrameInterval(double ms);
+    double frameInterval() const { return frameMs_; }
+
+    // wantRead: a fresh read is useful (not paused on a read frame, not
+    // holding a capture). wantPage: the warped page itself is shown; it is
+    // only warped without a read when no read is wanted.
+    Stage plan(bool wantRead, bool wantPage);
+
+    // Time this frame spent in the warp and the read (0 if not run) and in
+    // total, capture to display.
+    void record(double warpMs, double readMs, double totalMs);
+
+    void reset();
+
+    double baseCost() const { return baseMs_; }
+    double warpCost() const { return warpMs_; }
+    double readCost() const { return readMs_; }
+    // Frames per full read at the current costs (1 = every frame).
+    double readEvery() const;
+
+private:
+    double frameMs_;
+    int maxSkip_;
+
+    double baseMs_ = 0.0;
+    double warpMs_ = 0.0;
+    double readMs_ = 0.0;
+    bool measuredBase_ = false;
+    bool measuredWarp_ = false;
+    bool measuredRead_ = false;
+
+    double credit_ = 0.0;   // budget saved (+) or overdrawn (-), ms
+    int sinceRead_ = 0;
+
+    static void smooth(double& avg, bool& seeded, double sample);
+};
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+namespace core {
+
+// Box-mean adaptive threshold over one page. prepare() smooths the page once
+// and builds its integral image; any region can then be thresholded with any
+// block size from the same table at O(1) per pixel, instead of one Gaussian
+// convolution per region and parameter set.
+class LocalMeanThreshold {
+public:
+    void prepare(const cv::Mat& gray, int blur = 5);
+    void clear();
+    bool ready() const { return !sum_.empty(); }
+
+    // The smoothed page the thresholds are computed on.
+    const cv::Mat& smoothed() const { return smooth_; }
+
+    // Matches cv::adaptiveThreshold(smoothed()(roi), dst, 255,
+    // ADAPTIVE_THRESH_MEAN_C, THRESH_BINARY_INV, block, C), except that
+    // windows are clipped at the ROI border instead of replicating it (the
+    // page around a region may be blank when only regions were warped).
+    // Safe to call concurrently once prepared.
+    void binarizeInv(const cv::Rect& roi, int block, double C, cv::Mat& dst) const;
+
+private:
+    cv::Mat smooth_;    // CV_8UC1
+    cv::Mat sum_;       // CV_32SC1, (rows + 1) x (cols + 1)
+};
+
+}
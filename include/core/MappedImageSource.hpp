@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace core {
+
+// Read-only memory mapping of one input file. Move-only.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+
+    // Shared read-write mapping of exactly `size` bytes; the file is created
+    // or resized as needed. Writes go straight to the page cache.
+    bool openReadWrite(const std::string& path, size_t size);
+    void close();
+
+    // Ask the kernel to start reading the whole mapping in the background.
+    void adviseWillNeed() const;
+
+    const unsigned char* data() const { return data_; }
+    unsigned char* mutableData() const { return writable_ ? const_cast<unsigned char*>(data_) : nullptr; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// Sequential batch input: each file is mapped and handed to the decoder in
+// place (no read() into a heap buffer), while the next `prefetch` files are
+// already mapped with a readahead hint so disk I/O overlaps decoding.
+class MappedImageSource {
+public:
+    struct Item {
+        size_t index = 0;
+        std::string path;
+        MappedFile file;    // not open if mapping failed
+    };
+
+    MappedImageSource(std::vector<std::string> paths, int prefetch = 4);
+
+    bool next(Item& out);
+
+    // Restrict the source to inputs [begin, end).
+    void seek(size_t begin, size_t end = static_cast<size_t>(-1));
+
+    size_t size() const { return paths_.size(); }
+    size_t position() const { return cursor_; }
+
+private:
+    std::vector<std::string> paths_;
+    int prefetch_;
+    size_t cursor_ = 0;                 // next index to return
+    size_t end_ = 0;                    // one past the last index to return
+    size_t mappedUpTo_ = 0;             // next index to map ahead
+    std::deque<MappedFile> window_;     // files [cursor_, mappedUpTo_)
+
+    void fillWindow();
+};
+
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include "core/CornerFinder.hpp"
 
 namespace core {
@@ -10,6 +13,8 @@ struct WarpResult {
     cv::Mat warped;             
     cv::Mat debug;              
     std::array<cv::Point2f,4> corners{}; 
+    double quality = 0.0;       // CornerResult::quality of the marker set
+    int orientation = 0;        // quarter turns of the sheet in the frame
 };
 
 class PerspectiveCorrector {
@@ -18,9 +23,55 @@ public:
     
     WarpResult findAndWarp(const cv::Mat& bgr, bool wantDebug) const;
 
+    // Like findAndWarp, but only the given page rectangles are warped (each
+    // through H composed with its own offset) and enhanced. The result is a
+    // single-channel page whose other pixels are left black.
+    WarpResult findAndWarpRegions(const cv::Mat& bgr,
+                                  const std::vector<cv::Rect>& rects,
+                                  bool wantDebug) const;
+
+    // Split form of the two calls above for callers that need the page only
+    // on some frames: locate() finds the markers and the homography without
+    // warping, warp() / warpRegions() finish from its result.
+    CornerResult locate(const cv::Mat& bgr, bool wantDebug) const {
+        return finder_.processFrame(bgr, wantDebug, false);
+    }
+    WarpResult warp(const cv::Mat& bgr, const CornerResult& C, bool wantDebug) const;
+    WarpResult warpRegions(const cv::Mat& bgr, const CornerResult& C,
+                           const std::vector<cv::Rect>& rects, bool wantDebug) const;
+
+    // Enables upside-down detection; see CornerFinder::setOrientationLayout.
+    void setOrientationLayout(const std::vector<cv::Rect>& pageRects) {
+        finder_.setOrientationLayout(pageRects);
+    }
+    bool hasOrientationLayout() const { return finder_.hasOrientationLayout(); }
+
+    int outWidth() const { return outW_; }
+    int outHeight() const { return outH_; }
+
+    // Tracking mode for a camera on a stand: keep fixed-point remap tables
+    // for the last homography and reuse them while every marker stays
+    // within tolerancePx of where it was when the tables were built.
+    void setRemapCache(bool enabled, float tolerancePx = 0.5f);
+    uint64_t remapRebuilds() const;
+
 private:
+    struct RemapMaps {
+        std::array<cv::Point2f,4> corners;
+        cv::Mat map1;   // CV_16SC2
+        cv::Mat map2;   // CV_16UC1 interpolation table
+    };
+
+    std::shared_ptr<const RemapMaps> remapFor(const CornerResult& C) const;
+
     int outW_, outH_;
     CornerFinder finder_;
+
+    bool remapEnabled_ = false;
+    float remapTolerance_ = 0.5f;
+    mutable std::mutex remapMtx_;
+    mutable std::shared_ptr<const RemapMaps> remap_;
+    mutable uint64_t remapRebuilds_ = 0;
 };
 
 }
\ No newline at end of file
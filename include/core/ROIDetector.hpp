@@ -5,7 +5,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include "BubbleDetector.hpp"
+#include "AnswerVector.hpp"
+#include "AnswerKey.hpp"
+#include "TaskPool.hpp"
+#include "LocalMeanThreshold.hpp"
+#include "FillCalibrator.hpp"
+#include "GridAligner.hpp"
 
 class ROIDetector {
 public:
@@ -14,6 +21,14 @@ public:
         COLUMN
     };
     
+    // How process() binarizes the regions. BoxMean smooths the page once and
+    // thresholds every region from one integral image; Gaussian runs a blur
+    // and cv::adaptiveThreshold per region.
+    enum ThresholdMethod {
+        BoxMean,
+        Gaussian
+    };
+    
     struct RegionDef {
         std::string name;
         float rectPct[4];  
@@ -23,48 +38,113 @@ public:
     };
     
     struct QuestionDetail {
-        int questionNumber;
-        char markedAnswer;     
-        char correctAnswer;    
-        bool isCorrect;        
-        double fillRatio;      
+        int questionNumber;     // 0-based within the subject
+        char markedAnswer;      // AnswerVector::toChar of the read code
+        char correctAnswer;     // first accepted option, '-' if not in the key
+        bool isCorrect;         // scores under the key (cancelled counts)
+        double fillRatio;       // fused fill of the darkest cell in the row
+    };
+    
+    struct SheetRead {
+        std::map<std::string, std::string> fields;      // identity regions
+        std::map<std::string, AnswerVector> subjects;   // answer regions
+        double answerThreshold = 0.0;   // fill ratio that counted as marked
+        bool calibrated = false;        // answerThreshold came from this sheet
+        // Every cell's fill ratio, region by region in regionDefs() order,
+        // each row-major (rows * cols per region; zeros if not measured).
+        std::vector<float> cellFills;
     };
     
     ROIDetector();
+    ~ROIDetector();
     
-    std::map<std::string, std::string> process(const cv::Mat& warped, cv::Mat& debugOut);
+    SheetRead process(const cv::Mat& warped, cv::Mat& debugOut);
     
+    // process() plus a per-question comparison against the compiled key of
+    // the sheet's booklet, from the same single read (calibration, fusion
+    // and code mapping included). The read itself goes to *read if given.
     std::map<std::string, std::vector<QuestionDetail>> processWithDetails(
-        const cv::Mat& warped, 
+        const cv::Mat& warped,
         cv::Mat& debugOut,
-        const std::map<std::string, std::map<int, char>>& answerKey
+        const AnswerKey& answerKey,
+        SheetRead* read = nullptr
     );
     
     void setFillThreshold(double threshold);
     
     double getFillThreshold() const { return fillThreshold_; }
     
+    // Derive marked/unmarked cut-offs from each sheet's own fill ratios
+    // (two-class split); the fixed thresholds remain as the fallback for
+    // sheets that cannot be split, e.g. blank ones. On by default.
+    void setAutoCalibration(bool enabled) { autoCalibration_ = enabled; }
+    bool isAutoCalibration() const { return autoCalibration_; }
+    
+    // Snap each grid's cells to the printed bubble lattice (projection
+    // profiles) before measuring, so print drift and small warp errors do
+    // not push the sampling off the bubbles. On by default.
+    void setGridAlignment(bool enabled) { gridAlignment_ = enabled; }
+    bool isGridAlignment() const { return gridAlignment_; }
+    
+    void setThresholdMethod(ThresholdMethod method);
+    ThresholdMethod getThresholdMethod() const { return thresholdMethod_; }
+    
     void setDebugMode(bool enabled);
     cv::Mat getLastDebugVisualization() const;
+    
+    // Changes whenever the layout or read thresholds change; used to key
+    // cached reads so they are never reused under different settings.
+    uint64_t configFingerprint() const;
+    
+    // Page rectangles actually read by process(), including the margin grid
+    // alignment may move into; everything else on the warped page is ignored.
+    std::vector<cv::Rect> regionRects(const cv::Size& page) const;
+    const std::vector<RegionDef>& regionDefs() const { return regions_; }
+    
+    // Reads the booklet type (A-D, one bubble per row) from rectPct of the
+    // page into fields["kitapcik"]. Off until set: its place depends on the
+    // printed form (see AnswerKey::bookletRegion).
+    void setBookletRegion(const float rectPct[4]);
+    
+    // Multi-frame fusion of answer-region fill ratios for the live camera.
+    void setTemporalSmoothing(bool enabled, int historySize);
+    void resetTemporalHistory();
+    bool isReadStable() const;
+    
+    // Reads the regions of one sheet concurrently on a pool of n threads
+    // (1 = sequential). OpenCV's own thread count is the caller's to set
+    // (core::CvBudget); lower it so the two levels do not oversubscribe.
+    void setRegionThreads(int n);
+    int getRegionThreads() const { return pool_ ? pool_->size() : 1; }
 
 private:
+    struct RegionOutput {
+        bool valid = false;
+        cv::Rect roi;
+        std::string text;
+        std::vector<BubbleResult> bubbles;
+        std::vector<float> ratios;      // row-major cell fill ratios
+    };
+    
     std::vector<RegionDef> regions_;
     double fillThreshold_;
     BubbleDetector bubbleDetector_;
     bool debugMode_;
     cv::Mat lastDebugVis_;
+    std::unique_ptr<core::TaskPool> pool_;
+    ThresholdMethod thresholdMethod_ = BoxMean;
+    bool autoCalibration_ = true;
+    bool gridAlignment_ = true;
+    core::GridAligner gridAligner_;
+    core::LocalMeanThreshold localMean_;
     
-    std::vector<QuestionDetail> analyzeGridWithDetails(
-        const cv::Mat& roiGray,
-        int rows,
-        int cols,
-        const std::map<int, char>& correctAnswers,
-        std::vector<BubbleResult>* bubbleResults = nullptr,
-        char firstLabel = 'A'
-    );
+    void readRegion(size_t regionIdx, const cv::Mat& gray, RegionOutput& out);
     
     bool isSubjectRegion(const std::string& name) const;
-    std::string bubblesToAnswerString(const std::vector<BubbleResult>& results) const;
+    cv::Rect regionRect(const RegionDef& reg, const cv::Size& page) const;
+    cv::Rect alignedRect(const RegionDef& reg, const cv::Mat& gray) const;
+    uint8_t bubbleToCode(const BubbleResult& br, double markThreshold) const;
+    AnswerVector bubblesToAnswers(const std::vector<BubbleResult>& results, double markThreshold) const;
 };
 
 #endif 
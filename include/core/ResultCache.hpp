@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "MappedImageSource.hpp"
+#include "ROIDetector.hpp"
+
+namespace core {
+
+// On-disk cache of raw sheet reads keyed by a hash of the encoded image
+// bytes (salted with the reader configuration). A hit skips decode, corner
+// finding, warping and bubble reading; only scoring runs again.
+//
+// The file is a fixed-size open-addressing table of fixed-size records and
+// is used through a shared memory mapping. Lookups and inserts probe a
+// short window from the home slot; when the window is full the least
+// recently used record in it is replaced, so the file never grows past the
+// size given to open().
+class ResultCache {
+public:
+    static constexpr uint32_t kRecordSize = 1024;
+    static constexpr int kProbeWindow = 16;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+    };
+
+    bool open(const std::string& path, size_t maxBytes);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    // orientation: quarter turns the sheet was found in (0-3), kept with
+    // the read so a hit reports the same rotation as a fresh read.
+    bool lookup(uint64_t key, ROIDetector::SheetRead& out, int* orientation = nullptr);
+    void store(uint64_t key, const ROIDetector::SheetRead& read, int orientation = 0);
+
+    Stats stats() const;
+
+    // 64-bit XXH64 of the bytes.
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed);
+
+private:
+    struct Header;
+    struct Record;
+
+    MappedFile file_;
+    uint64_t capacity_ = 0;
+    mutable std::mutex mtx_;
+    Stats stats_;
+
+    Header* header() const;
+    Record* record(uint64_t slot) const;
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PerspectiveCorrector.hpp"
+#include "AnswerKey.hpp"
+#include "ResultCache.hpp"
+
+namespace core {
+
+// Rolling request latency window (last kCapacity requests).
+class LatencyStats {
+public:
+    static constexpr size_t kCapacity = 4096;
+
+    struct Summary {
+        uint64_t count = 0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    void record(double ms);
+    Summary summary() const;
+
+private:
+    mutable std::mutex mtx_;
+    std::vector<double> samples_;
+    size_t head_ = 0;
+    uint64_t count_ = 0;
+};
+
+// Long-running scoring service for scanner stations.
+//
+// Wire format (TCP, both directions): 4-byte big-endian length followed by
+// that many bytes. A request body is an encoded image (PNG/JPEG/...), the
+// reply body is the JSON sheet report. A zero-length request returns the
+// latency summary instead. A connection may carry any number of requests.
+class ScoringServer {
+public:
+    // Largest accepted frame: a colour A4 scan at 300 dpi is well under
+    // this even as PNG.
+    static constexpr uint32_t kMaxPayload = 16u * 1024u * 1024u;
+    // Request bodies held in memory at once across all connections; a
+    // request that would exceed it is answered with an error.
+    static constexpr size_t kMaxBytesInFlight = 256u * 1024u * 1024u;
+    // Connections beyond this are closed on accept.
+    static constexpr size_t kMaxConnections = 256;
+
+    ScoringServer(const PerspectiveCorrector& corrector,
+                  const AnswerKey& answerKey,
+                  double fillThreshold,
+                  int workers,
+                  ResultCache* cache = nullptr);
+    ~ScoringServer();
+
+    // Blocks in the accept loop until stop() is called.
+    bool serve(const std::string& bindAddress, int port);
+    // Closes the listener and every open connection and waits for the
+    // connection threads; queued jobs still finish. Not callable from a
+    // connection thread.
+    void stop();
+    // Async-signal-safe: makes serve() leave its accept loop, after which
+    // serve() runs stop() itself. For SIGINT / SIGTERM handlers.
+    void requestStop();
+
+    const LatencyStats& stats() const { return stats_; }
+
+private:
+    struct Job {
+        std::vector<unsigned char> payload;
+        std::promise<std::string> reply;
+    };
+
+    struct Connection {
+        long long sock = -1;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    const PerspectiveCorrector& corrector_;
+    const AnswerKey& answerKey_;
+    double fillThreshold_;
+    ResultCache* cache_;
+
+    std::vector<std::thread> workers_;
+    std::deque<Job> queue_;
+    std::mutex queueMtx_;
+    std::condition_variable queueCv_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<long long> listenSocket_{-1};
+    std::atomic<size_t> bytesInFlight_{0};
+
+    // Sockets are closed only after their thread is joined, so stop() never
+    // shuts down a descriptor number that has been reused.
+    std::list<std::unique_ptr<Connection>> connections_;
+    std::mutex connMtx_;
+
+    LatencyStats stats_;
+
+    void workerLoop();
+    std::string submit(std::vector<unsigned char>&& payload);
+    void handleConnection(Connection* conn);
+    void reapConnections();
+    std::string statsJson() const;
+};
+
+// Minimal blocking client for the wire format above.
+class ScoringClient {
+public:
+    ScoringClient() = default;
+    ~ScoringClient();
+
+    bool connect(const std::string& host, int port);
+    bool request(const std::vector<unsigned char>& payload, std::string& reply);
+    void close();
+
+private:
+    long long sock_ = -1;
+};
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include "BatchRunner.hpp"
+
+namespace core {
+
+// Multi-process batch: the input list is cut into contiguous shards, up to
+// `workers` child processes score one shard each, and the shard files are
+// concatenated in shard order, so the merged output is in input order
+// regardless of scheduling.
+//
+// Shard results live in <out>.shards/ until the merge. A finished shard is
+// renamed from .part to .jsonl, so an interrupted run resumes by skipping
+// every .jsonl already present. If a worker dies mid-shard (e.g. a decoder
+// crash on a corrupt image), the file it was on is recorded as failed and
+// a new worker continues the shard after it.
+class ShardedBatchRunner {
+public:
+    ShardedBatchRunner(const PerspectiveCorrector& corrector,
+                       const AnswerKey& answerKey,
+                       BatchOptions options);
+
+    int run();
+
+private:
+    const PerspectiveCorrector& corrector_;
+    const AnswerKey& answerKey_;
+    BatchOptions opt_;
+
+    std::string shardPath(size_t shard, bool done) const;
+    int runShardRange(const std::string& partPath, size_t begin, size_t end);
+    bool merge(size_t shardCount);
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <map>
+#include <string>
+#include "PerspectiveCorrector.hpp"
+#include "ROIDetector.hpp"
+#include "AnswerKey.hpp"
+#include "ResultCache.hpp"
+
+namespace core {
+
+struct SheetReport {
+    bool ok = false;
+    std::string error;
+    std::map<std::string, std::string> fields;
+    std::map<std::string, AnswerVector> subjects;
+    AnswerKey::ScoreResult score;
+    int orientation = 0;        // quarter turns the sheet was found in
+    double answerThreshold = 0.0;
+    bool calibrated = false;
+    std::vector<float> cellFills;   // see ROIDetector::SheetRead::cellFills
+    double elapsedMs = 0.0;
+    bool cached = false;
+};
+
+// Headless read of one sheet image: corners, warp, bubbles, score.
+// The corrector and answer key are shared read-only; each pipeline owns its
+// own ROIDetector, so use one pipeline per thread.
+class SheetPipeline {
+public:
+    SheetPipeline(const PerspectiveCorrector& corrector,
+                  const AnswerKey& answerKey,
+                  double fillThreshold = 0.40);
+
+    SheetReport run(const cv::Mat& bgr);
+    SheetReport runEncoded(const unsigned char* data, size_t size);
+
+    // Optional read cache for runEncoded(); may be shared between pipelines.
+    void setCache(ResultCache* cache) { cache_ = cache; }
+
+    // Warp only the regions the detector reads instead of the whole page.
+    void setRegionWarp(bool enabled);
+
+    // OpenCV thread count while warping / reading (0 = unchanged); see
+    // CvBudget for when this is safe.
+    void setStageThreads(int warpThreads, int readThreads) {
+        warpThreads_ = warpThreads;
+        readThreads_ = readThreads;
+    }
+
+    static nlohmann::json toJson(const SheetReport& report);
+
+    const ROIDetector& detector() const { return detector_; }
+
+private:
+    const PerspectiveCorrector& corrector_;
+    const AnswerKey& answerKey_;
+    ROIDetector detector_;
+    cv::Mat debugScratch_;
+    ResultCache* cache_ = nullptr;
+    bool regionWarp_ = false;
+    std::vector<cv::Rect> regionRects_;
+    int warpThreads_ = 0;
+    int readThreads_ = 0;
+};
+
+}
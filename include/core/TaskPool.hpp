@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+// Small fork-join pool for splitting one unit of work (e.g. the regions of a
+// single sheet) across threads. The calling thread takes part in every
+// parallelFor, so a pool of size N starts N-1 workers.
+class TaskPool {
+public:
+    explicit TaskPool(int threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Runs fn(0..n-1) and returns when all calls have finished. The first
+    // exception thrown by fn is rethrown here.
+    void parallelFor(int n, const std::function<void(int)>& fn);
+
+private:
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> workers_;
+    std::mutex mtx_;
+    std::condition_variable startCv_;
+    std::condition_variable doneCv_;
+    const std::function<void(int)>* job_ = nullptr;
+    std::atomic<int> next_{0};
+    int count_ = 0;
+    int running_ = 0;
+    unsigned generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace core
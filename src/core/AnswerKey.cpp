@@ -1,83 +1,323 @@
 #include "core/AnswerKey.hpp"
-#include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
 
-static std::vector<std::string> splitCSV(const std::string& s) {
-    std::vector<std::string> out;
-    std::stringstream ss(s);
-    std::string tok;
-    while (std::getline(ss, tok, ',')) {
-        size_t a = 0, b = tok.size();
-        while (a < b && isspace((unsigned char)tok[a])) a++;
-        while (b > a && isspace((unsigned char)tok[b - 1])) b--;
-        out.push_back(tok.substr(a, b - a));
-    }
-    return out;
+namespace {
+
+char normalizeBooklet(char c) {
+    if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    return (c >= 'A' && c <= 'Z') ? c : 0;
+}
+
+uint32_t optionBit(char c) {
+    uint8_t code = AnswerVector::fromChar(c);
+    return (AnswerVector::isAnswer(code) && code < 32) ? (1u << code) : 0u;
+}
+
+bool parseNumber(const std::string& s, double& out) {
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return end && *end == '\0' && !s.empty() && out >= 0.0;
+}
+
+} // namespace
+
+double AnswerKey::ScoringRules::penaltyFor(const std::string& subject) const {
+    auto it = subjectPenalty.find(subject);
+    return it != subjectPenalty.end() ? it->second : penalty;
+}
+
+double AnswerKey::ScoringRules::weightFor(const std::string& subject) const {
+    auto it = subjectWeight.find(subject);
+    return it != subjectWeight.end() ? it->second : 1.0;
+}
+
+int AnswerKey::CompiledKey::subjectIndex(const std::string& name) const {
+    for (size_t i = 0; i < subjects.size(); ++i)
+        if (subjects[i].name == name) return static_cast<int>(i);
+    return -1;
 }
 
 void AnswerKey::loadAnswerKey(const std::vector<QuestionAnswer>& keys) {
-    keyMap_.clear();
-    for (const auto& k : keys) {
-        keyMap_[k.subject][k.questionNumber] = k.correctAnswer;
+    booklets_.clear();
+    index_ = filledIndex();
+    loadBooklet('A', keys);
+}
+
+void AnswerKey::loadBooklet(char booklet, const std::vector<QuestionAnswer>& keys) {
+    char id = normalizeBooklet(booklet);
+    if (!id) return;
+
+    int s = slot(id);
+    if (s < 0) {
+        s = static_cast<int>(booklets_.size());
+        booklets_.push_back({id, {}, {}});
+        index_[id - 'A'] = s;
     }
+
+    Booklet& b = booklets_[s];
+    b.source = keys;
+    compile(b);
 }
 
-AnswerKey::ScoreResult AnswerKey::calculateScore(
-    const std::map<std::string, std::string>& studentAnswersCsv) 
-{
-    ScoreResult res;
+void AnswerKey::setRules(const ScoringRules& rules) {
+    rules_ = rules;
+    for (Booklet& b : booklets_) compile(b);
+}
 
-    for (const auto& pair : keyMap_) {
-        std::string subject = pair.first;
-        const auto& correctMap = pair.second; 
+void AnswerKey::compile(Booklet& b) const {
+    std::map<std::string, std::map<int, const QuestionAnswer*>> bySubject;
+    for (const auto& qa : b.source) {
+        if (qa.questionNumber < 0 || qa.questionNumber >= AnswerVector::kCapacity) continue;
+        bySubject[qa.subject][qa.questionNumber] = &qa;
+    }
 
-        SubjectStat stat;
-        
-        std::string rawAnswers = "";
-        if (studentAnswersCsv.find(subject) != studentAnswersCsv.end()) {
-            rawAnswers = studentAnswersCsv.at(subject);
+    CompiledKey k;
+    for (const auto& pair : bySubject) {
+        CompiledKey::Subject s;
+        s.name = pair.first;
+        s.first = static_cast<int>(k.accept.size());
+        s.count = pair.second.rbegin()->first + 1;
+        s.weight = rules_.weightFor(s.name);
+        s.penalty = rules_.penaltyFor(s.name);
+
+        k.accept.resize(s.first + s.count, 0u);
+        k.cancelled.resize(s.first + s.count, 0);
+        for (const auto& q : pair.second) {
+            uint32_t mask = optionBit(q.second->correctAnswer);
+            for (char c : q.second->alsoAccepted) mask |= optionBit(c);
+            k.accept[s.first + q.first] = mask;
+            k.cancelled[s.first + q.first] = q.second->cancelled ? 1 : 0;
         }
+        k.subjects.push_back(s);
+    }
+    b.compiled = std::move(k);
+}
 
-        std::vector<std::string> tokens = splitCSV(rawAnswers);
+bool AnswerKey::loadFromFile(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "Cevap anahtari acilamadi: " + path;
+        return false;
+    }
 
-        int maxQ = -1;
-        for (const auto& q : correctMap) {
-            if (q.first > maxQ) maxQ = q.first;
-        }
-        
-        for (int qIdx = 0; qIdx <= maxQ; ++qIdx) {
-            char correct = '-';
-            if (correctMap.find(qIdx) != correctMap.end()) {
-                correct = correctMap.at(qIdx);
+    struct Cancel {
+        std::string subject;
+        int question;
+        int line;
+    };
+
+    std::map<char, std::vector<QuestionAnswer>> parsed;
+    std::map<char, std::vector<Cancel>> cancels;
+    std::vector<char> order;
+    ScoringRules rules;
+    std::array<float, 4> region{};
+    bool hasRegion = false;
+    char current = 'A';
+    std::string line;
+    int lineNo = 0;
+
+    auto fail = [&](const std::string& msg) {
+        if (error) *error = path + ":" + std::to_string(lineNo) + ": " + msg;
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        std::istringstream ss(line);
+        std::vector<std::string> tok;
+        for (std::string t; ss >> t;) tok.push_back(t);
+        if (tok.empty()) continue;
+
+        const std::string& cmd = tok[0];
+        double value = 0.0;
+
+        if (cmd == "kitapcik") {
+            current = (tok.size() == 2 && tok[1].size() == 1) ? normalizeBooklet(tok[1][0]) : 0;
+            if (!current) return fail("gecersiz kitapcik satiri");
+        } else if (cmd == "ceza") {
+            if (tok.size() < 2 || tok.size() > 3 || !parseNumber(tok.back(), value)) {
+                return fail("beklenen: ceza [ders] N");
+            }
+            double penalty = value > 0.0 ? 1.0 / value : 0.0;
+            if (tok.size() == 2) rules.penalty = penalty;
+            else rules.subjectPenalty[tok[1]] = penalty;
+        } else if (cmd == "agirlik") {
+            if (tok.size() != 3 || !parseNumber(tok[2], value)) return fail("beklenen: agirlik <ders> W");
+            rules.subjectWeight[tok[1]] = value;
+        } else if (cmd == "kitapcik_alani") {
+            double v[4];
+            bool okRect = tok.size() == 5;
+            for (int i = 0; okRect && i < 4; ++i) okRect = parseNumber(tok[i + 1], v[i]) && v[i] >= 0.0;
+            if (!okRect || v[2] <= 0.0 || v[3] <= 0.0 || v[0] + v[2] > 1.0 || v[1] + v[3] > 1.0) {
+                return fail("beklenen: kitapcik_alani x y w h (sayfa orani, 0-1)");
             }
+            for (int i = 0; i < 4; ++i) region[i] = static_cast<float>(v[i]);
+            hasRegion = true;
+        } else if (cmd == "iptal") {
+            if (tok.size() < 3) return fail("beklenen: iptal <ders> <soru>...");
+            for (size_t i = 2; i < tok.size(); ++i) {
+                if (!parseNumber(tok[i], value) || value < 1.0) return fail("gecersiz soru: " + tok[i]);
+                cancels[current].push_back({tok[1], static_cast<int>(value) - 1, lineNo});
+            }
+        } else {
+            if (tok.size() != 2) return fail("beklenen: <ders> <cevaplar>");
 
-            char student = '-';
-            if (qIdx < (int)tokens.size()) {
-                std::string t = tokens[qIdx];
-                if (!t.empty()) student = t[0]; 
+            std::vector<QuestionAnswer> answers;
+            const std::string& keys = tok[1];
+            for (size_t i = 0; i < keys.size(); ++i) {
+                QuestionAnswer qa{cmd, static_cast<int>(answers.size()), 0};
+                if (keys[i] == '[') {
+                    size_t close = keys.find(']', i);
+                    if (close == std::string::npos || close == i + 1) return fail("gecersiz cevap kumesi");
+                    for (size_t j = i + 1; j < close; ++j) {
+                        if (!optionBit(keys[j])) return fail(std::string("gecersiz cevap: ") + keys[j]);
+                    }
+                    qa.correctAnswer = keys[i + 1];
+                    qa.alsoAccepted = keys.substr(i + 2, close - i - 2);
+                    i = close;
+                } else {
+                    if (!optionBit(keys[i])) return fail(std::string("gecersiz cevap: ") + keys[i]);
+                    qa.correctAnswer = keys[i];
+                }
+                answers.push_back(qa);
+            }
+            if (answers.size() > static_cast<size_t>(AnswerVector::kCapacity)) {
+                return fail("cok fazla soru: " + cmd);
             }
 
-            if (student == 'X' || student == '-' || student == ' ' || student == '?') {
-                stat.empty++;
-            } 
-            else if (student == correct) {
-                stat.correct++;
-            } 
-            else {
-                stat.wrong++;
+            if (parsed.find(current) == parsed.end()) order.push_back(current);
+            auto& all = parsed[current];
+            all.insert(all.end(), answers.begin(), answers.end());
+        }
+    }
+
+    for (const auto& pair : cancels) {
+        for (const Cancel& c : pair.second) {
+            lineNo = c.line;
+            bool found = false;
+            for (auto& qa : parsed[pair.first]) {
+                if (qa.subject == c.subject && qa.questionNumber == c.question) {
+                    qa.cancelled = true;
+                    found = true;
+                }
             }
+            if (!found) return fail("iptal edilen soru anahtarda yok: " + c.subject);
         }
+    }
 
-        stat.net = stat.correct - (stat.wrong / 3.0);
+    if (order.empty()) {
+        lineNo = 0;
+        return fail("cevap bulunamadi");
+    }
 
-        res.totalQuestions += (stat.correct + stat.wrong + stat.empty);
-        res.totalCorrect += stat.correct;
-        res.totalWrong += stat.wrong;
-        res.totalEmpty += stat.empty;
-        res.totalScore += stat.net;
-        res.subjectDetails[subject] = stat;
+    rules_ = rules;
+    bookletRegion_ = region;
+    hasBookletRegion_ = hasRegion;
+    booklets_.clear();
+    index_ = filledIndex();
+    for (char id : order) loadBooklet(id, parsed[id]);
+    return true;
+}
+
+int AnswerKey::slot(char booklet) const {
+    char id = normalizeBooklet(booklet);
+    return id ? index_[id - 'A'] : -1;
+}
+
+uint64_t AnswerKey::fingerprint() const {
+    // FNV-1a over every booklet's compiled table.
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const void* p, size_t n) {
+        const unsigned char* b = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= b[i];
+            h *= 1099511628211ull;
+        }
+    };
+
+    for (const auto& b : booklets_) {
+        mix(&b.id, 1);
+        for (const auto& s : b.compiled.subjects) {
+            mix(s.name.data(), s.name.size() + 1);
+            mix(&s.first, sizeof(s.first));
+            mix(&s.count, sizeof(s.count));
+            mix(&s.weight, sizeof(s.weight));
+            mix(&s.penalty, sizeof(s.penalty));
+        }
+        mix(b.compiled.accept.data(), b.compiled.accept.size() * sizeof(uint32_t));
+        mix(b.compiled.cancelled.data(), b.compiled.cancelled.size());
+    }
+    return h;
+}
+
+std::string AnswerKey::booklets() const {
+    std::string ids;
+    for (const auto& b : booklets_) ids.push_back(b.id);
+    return ids;
+}
+
+char AnswerKey::bookletFromFields(const std::map<std::string, std::string>& fields) {
+    auto it = fields.find("kitapcik");
+    if (it == fields.end() || it->second.size() != 1) return 0;
+    return normalizeBooklet(it->second[0]);
+}
+
+const AnswerKey::CompiledKey& AnswerKey::compiled(char booklet) const {
+    static const CompiledKey none;
+    if (booklets_.empty()) return none;
+    int s = slot(booklet);
+    return booklets_[s >= 0 ? s : 0].compiled;
+}
+
+const AnswerKey::Booklet* AnswerKey::resolve(char booklet, ScoreResult& res) const {
+    if (booklets_.empty()) return nullptr;
+    int s = slot(booklet);
+    if (s < 0) {
+        s = 0;
+        res.bookletMissing = booklets_.size() > 1;
+    }
+    res.booklet = booklets_[s].id;
+    return &booklets_[s];
+}
+
+AnswerKey::ScoreResult AnswerKey::calculateScore(
+    const std::map<std::string, AnswerVector>& studentAnswers, char booklet) const
+{
+    ScoreResult res;
+    static const AnswerVector noAnswers;
+
+    const Booklet* b = resolve(booklet, res);
+    if (!b) return res;
+
+    const CompiledKey& key = b->compiled;
+    for (const auto& subject : key.subjects) {
+        auto it = studentAnswers.find(subject.name);
+        const AnswerVector& student = (it != studentAnswers.end()) ? it->second : noAnswers;
+
+        SubjectStat stat;
+        key.count(subject, student, stat.correct, stat.wrong);
+        stat.empty = subject.count - stat.correct - stat.wrong;
+        stat.net = subject.net(stat.correct, stat.wrong);
+
+        finishSubject(res, subject.name, stat);
     }
 
     return res;
-}
\ No newline at end of file
+}
+
+void AnswerKey::finishSubject(ScoreResult& res, const std::string& subject, SubjectStat& stat) {
+    res.totalQuestions += (stat.correct + stat.wrong + stat.empty);
+    res.totalCorrect += stat.correct;
+    res.totalWrong += stat.wrong;
+    res.totalEmpty += stat.empty;
+    res.totalScore += stat.net;
+    res.subjectDetails[subject] = stat;
+}
@@ -0,0 +1,62 @@
+#include "core/AutoCapture.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+AutoCapture::AutoCapture(int window, double maxJitterPx, int removalFrames)
+    : window_(std::clamp(window, 2, kMaxWindow)),
+      maxJitterPx_(maxJitterPx),
+      removalFrames_(std::max(1, removalFrames)) {}
+
+void AutoCapture::reset() {
+    state_ = State::Armed;
+    head_ = 0;
+    filled_ = 0;
+    missing_ = 0;
+    lastJitter_ = 0.0;
+}
+
+double AutoCapture::windowJitter() const {
+    double worst = 0.0;
+
+    for (int k = 0; k < 4; ++k) {
+        cv::Point2f mean(0.f, 0.f);
+        for (int i = 0; i < filled_; ++i) mean += ring_[i][k];
+        mean = mean / static_cast<double>(filled_);
+
+        for (int i = 0; i < filled_; ++i) {
+            cv::Point2f d = ring_[i][k] - mean;
+            worst = std::max(worst, std::sqrt((double)d.x * d.x + (double)d.y * d.y));
+        }
+    }
+    return worst;
+}
+
+bool AutoCapture::update(bool paperOk,
+                         const std::array<cv::Point2f, 4>& markers,
+                         bool readStable) {
+    if (!paperOk) {
+        filled_ = 0;
+        head_ = 0;
+        if (++missing_ >= removalFrames_) state_ = State::Armed;
+        return false;
+    }
+    missing_ = 0;
+
+    if (state_ == State::Captured) return false;
+
+    ring_[head_] = markers;
+    head_ = (head_ + 1) % window_;
+    if (filled_ < window_) filled_++;
+
+    if (filled_ < window_) return false;
+
+    lastJitter_ = windowJitter();
+    if (lastJitter_ > maxJitterPx_ || !readStable) return false;
+
+    state_ = State::Captured;
+    return true;
+}
+
+}
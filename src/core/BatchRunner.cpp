@@ -0,0 +1,266 @@
+#include "core/BatchRunner.hpp"
+#include "core/MappedImageSource.hpp"
+#include "core/SheetPipeline.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace core {
+
+namespace {
+
+std::string lowerExt(const fs::path& p) {
+    std::string e = p.extension().string();
+    std::transform(e.begin(), e.end(), e.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return e;
+}
+
+bool isImageExt(const std::string& e) {
+    return e == ".jpg" || e == ".jpeg" || e == ".png" || e == ".bmp" ||
+           e == ".tif" || e == ".tiff" || e == ".webp";
+}
+
+}
+
+BatchRunner::BatchRunner(const PerspectiveCorrector& corrector,
+                         const AnswerKey& answerKey,
+                         BatchOptions options)
+    : corrector_(corrector), answerKey_(answerKey), opt_(std::move(options)) {}
+
+std::vector<std::string> BatchRunner::expandInputs(const std::vector<std::string>& args) {
+    std::vector<std::string> out;
+
+    for (const auto& a : args) {
+        fs::path p(a);
+        std::error_code ec;
+
+        if (fs::is_directory(p, ec)) {
+            std::vector<std::string> files;
+            for (const auto& e : fs::directory_iterator(p, ec)) {
+                if (e.is_regular_file(ec) && isImageExt(lowerExt(e.path())))
+                    files.push_back(e.path().string());
+            }
+            std::sort(files.begin(), files.end());
+            out.insert(out.end(), files.begin(), files.end());
+        }
+        else if (lowerExt(p) == ".txt" || lowerExt(p) == ".lst") {
+            std::ifstream in(a);
+            std::string line;
+            while (std::getline(in, line)) {
+                while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+                if (!line.empty()) out.push_back(line);
+            }
+        }
+        else {
+            out.push_back(a);
+        }
+    }
+    return out;
+}
+
+bool BatchRunner::openFills(FillTensorFile& fills, const BatchOptions& opt,
+                            const SheetPipeline& pipeline, bool keep) {
+    std::vector<FillTensorFile::Region> layout;
+    for (const auto& reg : pipeline.detector().regionDefs()) layout.push_back({reg.name, reg.rows, reg.cols});
+    return fills.open(opt.fillsPath, opt.inputs.size(), layout, keep);
+}
+
+std::string BatchRunner::checkpointPath() const {
+    return opt_.outPath + ".ckpt";
+}
+
+uint64_t BatchRunner::runFingerprint(const SheetPipeline& pipeline) const {
+    std::string bytes;
+    for (const auto& path : opt_.inputs) {
+        bytes += path;
+        bytes.push_back('\0');
+    }
+    const uint64_t settings[] = {
+        pipeline.detector().configFingerprint(),
+        answerKey_.fingerprint(),
+        static_cast<uint64_t>(corrector_.outWidth()),
+        static_cast<uint64_t>(corrector_.outHeight()),
+        corrector_.hasOrientationLayout() ? 1ull : 0ull,
+        opt_.regionWarp ? 1ull : 0ull,
+        opt_.fillsPath.empty() ? 0ull : 1ull
+    };
+    bytes.append(reinterpret_cast<const char*>(settings), sizeof(settings));
+    return ResultCache::hashBytes(bytes.data(), bytes.size(), 0);
+}
+
+bool BatchRunner::loadCheckpoint(Checkpoint& ck) const {
+    std::ifstream in(checkpointPath());
+    std::string magic;
+    if (!(in >> magic >> ck.runHash >> ck.inputCount >> ck.begin >> ck.end >> ck.next >> ck.offset)) return false;
+    return magic == "omr-ckpt-2";
+}
+
+bool BatchRunner::saveCheckpoint(const Checkpoint& ck) const {
+    const std::string tmp = checkpointPath() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << "omr-ckpt-2 " << ck.runHash << ' ' << ck.inputCount << ' ' << ck.begin << ' ' << ck.end << ' '
+            << ck.next << ' ' << ck.offset << '\n';
+        if (!out.good()) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, checkpointPath(), ec);
+    return !ec;
+}
+
+int BatchRunner::run() {
+    const size_t end = std::min(opt_.end, opt_.inputs.size());
+    const size_t begin = std::min(opt_.begin, end);
+    const bool checkpointing = opt_.checkpointEvery > 0 && !opt_.append;
+
+    SheetPipeline pipeline(corrector_, answerKey_, opt_.fillThreshold);
+    pipeline.setRegionWarp(opt_.regionWarp);
+    pipeline.setStageThreads(opt_.cv.warpThreads, opt_.cv.readThreads);
+
+    Checkpoint ck;
+    ck.runHash = checkpointing ? runFingerprint(pipeline) : 0;
+    ck.inputCount = opt_.inputs.size();
+    ck.begin = begin;
+    ck.end = end;
+    ck.next = begin;
+    ck.offset = 0;
+
+    // Resume: drop anything written after the last checkpoint, then append.
+    bool resumed = false;
+    if (checkpointing) {
+        Checkpoint old;
+        std::error_code ec;
+        bool found = loadCheckpoint(old);
+        if (found && old.runHash != ck.runHash) {
+            // Another input list or other settings: the old output is not
+            // a prefix of this run's.
+            std::cerr << "Kontrol noktasi farkli girdi/ayarlara ait; bastan baslaniyor\n";
+            found = false;
+        }
+        if (found &&
+            old.inputCount == ck.inputCount && old.begin == begin && old.end == end &&
+            old.next >= begin && old.next <= end &&
+            fs::exists(opt_.outPath, ec) && fs::file_size(opt_.outPath, ec) >= old.offset) {
+            fs::resize_file(opt_.outPath, old.offset, ec);
+            if (!ec) {
+                ck = old;
+                resumed = true;
+            }
+        }
+    }
+
+    std::ofstream out(opt_.outPath,
+                      std::ios::binary | ((opt_.append || resumed) ? std::ios::app : std::ios::trunc));
+    if (!out) {
+        std::cerr << "Cikti dosyasi acilamadi: " << opt_.outPath << "\n";
+        return 1;
+    }
+
+    if (resumed && !opt_.quiet) {
+        std::cout << "Kontrol noktasindan devam: " << (ck.next - begin) << "/" << (end - begin)
+                  << " form zaten islenmis\n";
+    }
+
+    applyCvBudget(opt_.cv);
+
+    ResultCache cache;
+    // A cache record holds the read, not every cell's fill: with a fills
+    // export each sheet is measured.
+    if (!opt_.cachePath.empty() && !opt_.fillsPath.empty()) {
+        if (!opt_.quiet) std::cerr << "Olcum dosyasi yazilirken onbellek kullanilmaz\n";
+    } else if (!opt_.cachePath.empty()) {
+        if (cache.open(opt_.cachePath, opt_.cacheBytes)) pipeline.setCache(&cache);
+        else std::cerr << "Onbellek acilamadi: " << opt_.cachePath << "\n";
+    }
+
+    FillTensorFile fills;
+    if (!opt_.fillsPath.empty() && !openFills(fills, opt_, pipeline, resumed || opt_.append))
+        std::cerr << "Olcum dosyasi acilamadi: " << opt_.fillsPath << "\n";
+
+    MappedImageSource source(opt_.inputs, opt_.prefetch);
+    source.seek(ck.next, end);
+    const size_t startIndex = ck.next;
+
+    size_t okCount = 0;
+    size_t sinceCheckpoint = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    MappedImageSource::Item item;
+    while (source.next(item)) {
+        SheetReport rep;
+        if (item.file.isOpen()) {
+            // One bad sheet gets its own failure row; the run goes on.
+            try {
+                rep = pipeline.runEncoded(item.file.data(), item.file.size());
+            } catch (const std::exception& e) {
+                rep = SheetReport();
+                rep.error = std::string("internal error: ") + e.what();
+            }
+        } else {
+            rep.error = "file open failed";
+        }
+        item.file.close();
+
+        if (rep.ok) okCount++;
+
+        if (fills.isOpen()) {
+            auto status = !rep.ok ? FillTensorFile::Failed
+                        : rep.cached ? FillTensorFile::Cached : FillTensorFile::Measured;
+            fills.write(item.index, status, rep.cellFills, rep.answerThreshold, rep.calibrated,
+                        rep.orientation);
+        }
+
+        nlohmann::json j = SheetPipeline::toJson(rep);
+        j["index"] = item.index;
+        j["file"] = item.path;
+
+        std::string line = j.dump();
+        line.push_back('\n');
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+
+        ck.next = item.index + 1;
+        ck.offset += line.size();
+
+        // Shard workers flush every line so the coordinator can see progress.
+        if (opt_.append) out.flush();
+
+        if (checkpointing && ++sinceCheckpoint >= static_cast<size_t>(opt_.checkpointEvery)) {
+            out.flush();
+            if (out.good()) saveCheckpoint(ck);
+            sinceCheckpoint = 0;
+        }
+    }
+    out.flush();
+
+    if (checkpointing) {
+        std::error_code ec;
+        if (out.good()) fs::remove(checkpointPath(), ec);
+        else saveCheckpoint(ck);
+    }
+
+    if (!opt_.quiet) {
+        const size_t n = end - startIndex;
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Toplu islem: " << n << " form, " << okCount << " basarili (bu calistirmada), "
+                  << sec << " sn";
+        if (sec > 0) std::cout << " (" << (n / sec) << " form/sn)";
+        std::cout << "\n";
+
+        if (cache.isOpen()) {
+            ResultCache::Stats cs = cache.stats();
+            std::cout << "Onbellek: " << cs.hits << " isabet, " << cs.misses << " kayip, "
+                      << cs.evictions << " tahliye\n";
+        }
+    }
+
+    return out.good() ? 0 : 1;
+}
+
+}
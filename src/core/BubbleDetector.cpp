@@ -2,10 +2,22 @@
 #include <algorithm>
 #include <iostream>
 #include <numeric>
+#include <cmath>
 
 using namespace cv;
 using namespace std;
 
+namespace {
+
+cv::Mat binarizeGrid(const cv::Mat& roiGray) {
+    cv::Mat blurImg, thr;
+    cv::GaussianBlur(roiGray, blurImg, cv::Size(5, 5), 0);
+    cv::adaptiveThreshold(blurImg, thr, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, 15, 3);
+    return thr;
+}
+
+}
+
 BubbleDetector::BubbleDetector(double fillThreshold)
     : fillThreshold_(fillThreshold),
       minSeparation_(10.0),
@@ -26,31 +38,113 @@ cv::Rect BubbleDetector::refineBubbleRect(const cv::Mat& cellPatch, const cv::Re
     return initialRect;
 }
 
+void BubbleDetector::setTemporalSmoothing(bool enabled, int historySize) {
+    temporalSmoothingEnabled_ = enabled;
+    historySize_ = std::max(1, historySize);
+    resetHistory();
+}
+
+void BubbleDetector::resetHistory() {
+    for (auto& pair : answerHistory_) {
+        FillHistory& h = pair.second;
+        h.head = 0;
+        h.filled = 0;
+        h.stableFrames = 0;
+        h.maxStdDev = 1.0;
+        std::fill(h.sum.begin(), h.sum.end(), 0.0);
+        std::fill(h.sumSq.begin(), h.sumSq.end(), 0.0);
+        h.lastDecoded.clear();
+    }
+}
+
+void BubbleDetector::prepareHistory(int historyKey) {
+    if (temporalSmoothingEnabled_ && historyKey >= 0)
+        answerHistory_.emplace(historyKey, FillHistory());
+}
+
+bool BubbleDetector::isHistoryStable(int historyKey) const {
+    auto it = answerHistory_.find(historyKey);
+    if (it == answerHistory_.end()) return false;
+
+    const double STABLE_STDDEV = 0.08;
+    const FillHistory& h = it->second;
+    return h.filled == historySize_ &&
+           h.stableFrames >= historySize_ - 1 &&
+           h.maxStdDev <= STABLE_STDDEV;
+}
+
+void BubbleDetector::commitDecoded(int historyKey, const AnswerVector& answers) {
+    auto it = answerHistory_.find(historyKey);
+    if (it == answerHistory_.end()) return;
+
+    FillHistory& h = it->second;
+    bool same = h.lastDecoded.count == answers.count &&
+                std::equal(answers.codes.begin(), answers.codes.begin() + answers.count,
+                           h.lastDecoded.codes.begin());
+    h.stableFrames = same ? h.stableFrames + 1 : 0;
+    h.lastDecoded = answers;
+}
+
+void BubbleDetector::pushHistory(FillHistory& h, std::vector<double>& ratios, int rows, int cols) {
+    const int n = rows * cols;
+
+    if (h.rows != rows || h.cols != cols || (int)h.ring.size() != historySize_ * n) {
+        h = FillHistory();
+        h.rows = rows;
+        h.cols = cols;
+        h.ring.assign(historySize_ * n, 0.0f);
+        h.sum.assign(n, 0.0);
+        h.sumSq.assign(n, 0.0);
+    }
+
+    float* slot = &h.ring[h.head * n];
+    const bool full = (h.filled == historySize_);
+
+    for (int i = 0; i < n; ++i) {
+        if (full) {
+            h.sum[i] -= slot[i];
+            h.sumSq[i] -= (double)slot[i] * slot[i];
+        }
+        slot[i] = static_cast<float>(ratios[i]);
+        h.sum[i] += slot[i];
+        h.sumSq[i] += (double)slot[i] * slot[i];
+    }
+
+    h.head = (h.head + 1) % historySize_;
+    if (!full) h.filled++;
+
+    double maxVar = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double mean = h.sum[i] / h.filled;
+        double var = h.sumSq[i] / h.filled - mean * mean;
+        maxVar = std::max(maxVar, var);
+        ratios[i] = mean;
+    }
+    h.maxStdDev = std::sqrt(maxVar);
+}
+
 std::vector<BubbleResult> BubbleDetector::detectBubblesGridCore(
-    const cv::Mat& roiGray,
+    const cv::Mat& roiBin,
     int rows,
     int cols,
     int startQuestionNumber,
     char firstLabel,
-    bool applySmoothing,
-    std::vector<std::vector<double>>* cellFillRatios)
+    int historyKey,
+    std::vector<float>* cellFillRatios)
 {
-    cv::Mat blurImg, thr;
-    cv::GaussianBlur(roiGray, blurImg, cv::Size(5, 5), 0);
-    cv::adaptiveThreshold(blurImg, thr, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, 15, 3);
-
+    cv::Mat thr;
     cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-    cv::morphologyEx(thr, thr, cv::MORPH_OPEN, kernel);
+    cv::morphologyEx(roiBin, thr, cv::MORPH_OPEN, kernel);
 
-    std::vector<BubbleResult> results;
-    int cellW = roiGray.cols / cols;
-    int cellH = roiGray.rows / rows;
+    int cellW = thr.cols / cols;
+    int cellH = thr.rows / rows;
 
-    for (int r = 0; r < rows; ++r) {
-        double bestVal = 0.0;
-        double secondVal = 0.0;
-        int bestIdx = -1;
+    // Per-thread scratch so regions can be read concurrently without
+    // reallocating on every frame.
+    thread_local std::vector<double> cellRatios;
+    cellRatios.assign(rows * cols, 0.0);
 
+    for (int r = 0; r < rows; ++r) {
         for (int c = 0; c < cols; ++c) {
             int marginX = static_cast<int>(cellW * 0.15);
             int marginY = static_cast<int>(cellH * 0.15);
@@ -59,7 +153,31 @@ std::vector<BubbleResult> BubbleDetector::detectBubblesGridCore(
             cell &= cv::Rect(0, 0, thr.cols, thr.rows);
             if (cell.width <= 0 || cell.height <= 0) continue;
 
-            double ratio = calculateFillRatio(thr(cell));
+            cellRatios[r * cols + c] = calculateFillRatio(thr(cell));
+        }
+    }
+
+    FillHistory* history = nullptr;
+    if (temporalSmoothingEnabled_ && historyKey >= 0) {
+        auto it = answerHistory_.find(historyKey);
+        if (it == answerHistory_.end())
+            it = answerHistory_.emplace(historyKey, FillHistory()).first;
+        history = &it->second;
+        pushHistory(*history, cellRatios, rows, cols);
+    }
+
+    if (cellFillRatios) cellFillRatios->assign(cellRatios.begin(), cellRatios.end());
+
+    std::vector<BubbleResult> results;
+    results.reserve(rows);
+
+    for (int r = 0; r < rows; ++r) {
+        double bestVal = 0.0;
+        double secondVal = 0.0;
+        int bestIdx = -1;
+
+        for (int c = 0; c < cols; ++c) {
+            double ratio = cellRatios[r * cols + c];
 
             if (ratio > bestVal) {
                 secondVal = bestVal;
@@ -84,6 +202,7 @@ std::vector<BubbleResult> BubbleDetector::detectBubblesGridCore(
         }
         results.push_back(res);
     }
+
     return results;
 }
 
@@ -94,7 +213,33 @@ std::vector<BubbleResult> BubbleDetector::detectBubbles(
     int startQuestionNumber,
     char firstLabel)
 {
-    return detectBubblesGridCore(roiGray, rows, cols, startQuestionNumber, firstLabel, false, nullptr);
+    return detectBubblesGridCore(binarizeGrid(roiGray), rows, cols, startQuestionNumber, firstLabel, -1, nullptr);
+}
+
+std::vector<BubbleResult> BubbleDetector::detectBubblesSmoothed(
+    const cv::Mat& roiGray,
+    int rows,
+    int cols,
+    int startQuestionNumber,
+    char firstLabel,
+    int historyKey,
+    std::vector<float>* cellFillRatios)
+{
+    return detectBubblesGridCore(binarizeGrid(roiGray), rows, cols, startQuestionNumber, firstLabel,
+                                 historyKey, cellFillRatios);
+}
+
+std::vector<BubbleResult> BubbleDetector::detectBubblesSmoothedBinary(
+    const cv::Mat& roiBin,
+    int rows,
+    int cols,
+    int startQuestionNumber,
+    char firstLabel,
+    int historyKey,
+    std::vector<float>* cellFillRatios)
+{
+    return detectBubblesGridCore(roiBin, rows, cols, startQuestionNumber, firstLabel, historyKey,
+                                 cellFillRatios);
 }
 
 std::vector<BubbleResult> BubbleDetector::detectBubblesWithContours(
@@ -105,7 +250,8 @@ std::vector<BubbleResult> BubbleDetector::detectBubblesWithContours(
     char firstLabel,
     cv::Mat* debugVis)
 {
-    auto results = detectBubblesGridCore(roiGray, rows, cols, startQuestionNumber, firstLabel, false, nullptr);
+    auto results = detectBubblesGridCore(binarizeGrid(roiGray), rows, cols, startQuestionNumber, firstLabel,
+                                         -1, nullptr);
 
     if (debugVis) {
         if (debugVis->empty() || debugVis->size() != roiGray.size()) {
@@ -1,37 +1,346 @@
 #include "core/CornerFinder.hpp"
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 
 using namespace cv;
 
 namespace core {
 
+namespace {
+
+// 0 at `bad`, 1 at `good`, linear in between (either direction).
+double ramp(double v, double bad, double good) {
+    double t = (v - bad) / (good - bad);
+    return std::clamp(t, 0.0, 1.0);
+}
+
+double len(const Point2f& p) {
+    return std::sqrt((double)p.x * p.x + (double)p.y * p.y);
+}
+
+// TL, TR, BR, BL by x+y and y-x extremes.
+void orderCorners(const Point2f* in, Point2f* out) {
+    Point2f p[4] = {in[0], in[1], in[2], in[3]};
+    std::sort(p, p + 4, [](const Point2f& a, const Point2f& b) {
+        return (a.x + a.y) < (b.x + b.y);
+    });
+    if ((p[1].y - p[1].x) > (p[2].y - p[2].x)) std::swap(p[1], p[2]);
+    out[0] = p[0];
+    out[1] = p[1];
+    out[2] = p[3];
+    out[3] = p[2];
+}
+
+struct QuadShape {
+    bool convex = false;
+    double side_ratio = 0.0;
+    double aspect_ratio = 0.0;
+    double min_angle = 180.0;
+    double max_angle = 0.0;
+    double area = 0.0;
+};
+
+// c is ordered TL, TR, BR, BL. With anyTurn the page may also be lying on
+// its side, i.e. the aspect is compared against 1/expectedAspect as well.
+QuadShape measureQuad(const Point2f* c, double expectedAspect, bool anyTurn = false) {
+    QuadShape q;
+    double side[4];
+    double cross[4];
+    for (int i = 0; i < 4; ++i) {
+        Point2f a = c[(i + 3) % 4] - c[i];
+        Point2f b = c[(i + 1) % 4] - c[i];
+        side[i] = len(b);
+        cross[i] = (double)a.x * b.y - (double)a.y * b.x;
+        double cosA = (a.x * b.x + a.y * b.y) / std::max(1e-9, len(a) * len(b));
+        double ang = std::acos(std::clamp(cosA, -1.0, 1.0)) * 180.0 / CV_PI;
+        q.min_angle = std::min(q.min_angle, ang);
+        q.max_angle = std::max(q.max_angle, ang);
+        q.area += 0.5 * ((double)c[i].x * c[(i + 1) % 4].y - (double)c[(i + 1) % 4].x * c[i].y);
+    }
+    q.area = std::abs(q.area);
+
+    q.convex = (cross[0] > 0 && cross[1] > 0 && cross[2] > 0 && cross[3] > 0) ||
+               (cross[0] < 0 && cross[1] < 0 && cross[2] < 0 && cross[3] < 0);
+
+    // side[0]=top, side[1]=right, side[2]=bottom, side[3]=left
+    double tb = std::min(side[0], side[2]) / std::max(1e-9, std::max(side[0], side[2]));
+    double lr = std::min(side[1], side[3]) / std::max(1e-9, std::max(side[1], side[3]));
+    q.side_ratio = std::min(tb, lr);
+
+    double measured = (side[0] + side[2]) / std::max(1e-9, side[1] + side[3]);
+    q.aspect_ratio = std::min(measured / expectedAspect, expectedAspect / measured);
+    if (anyTurn) {
+        double turned = measured * expectedAspect;
+        q.aspect_ratio = std::max(q.aspect_ratio, std::min(turned, 1.0 / turned));
+    }
+    return q;
+}
+
+double coefficientOfVariation(const double* v, int n) {
+    double mean = 0.0;
+    for (int i = 0; i < n; ++i) mean += v[i];
+    mean /= n;
+    if (mean <= 0.0) return 1.0;
+    double var = 0.0;
+    for (int i = 0; i < n; ++i) var += (v[i] - mean) * (v[i] - mean);
+    return std::sqrt(var / n) / mean;
+}
+
+// Worst of the individual checks, 0 (unusable) .. 1.
+double shapeScore(const QuadShape& q, double sizeCv) {
+    if (!q.convex) return 0.0;
+    return std::min({
+        ramp(q.min_angle, 40.0, 70.0),
+        ramp(q.max_angle, 140.0, 110.0),
+        ramp(q.side_ratio, 0.5, 0.85),
+        ramp(q.aspect_ratio, 0.6, 0.85),
+        ramp(sizeCv, 0.4, 0.1)
+    });
+}
+
+}
+
+Point2f CornerFinder::refineMarker(const Mat& gray, const std::vector<Point>& contour,
+                                   Point2f centroid, Quad& quad) const {
+    Rect br = boundingRect(contour);
+    std::vector<Point> approx;
+    approxPolyDP(contour, approx, 0.04 * arcLength(contour, true), true);
+
+    std::vector<Point2f> pts;
+    if (approx.size() == 4 && isContourConvex(approx)) {
+        for (const auto& p : approx) pts.emplace_back((float)p.x, (float)p.y);
+        int win = std::clamp(std::min(br.width, br.height) / 4, 2, 5);
+        cornerSubPix(gray, pts, Size(win, win), Size(-1, -1),
+                     TermCriteria(TermCriteria::COUNT | TermCriteria::EPS, 20, 0.01));
+    } else {
+        Point2f p[4];
+        minAreaRect(contour).points(p);
+        pts.assign(p, p + 4);
+    }
+    for (int i = 0; i < 4; ++i) quad[i] = pts[i];
+
+    Point2f d1 = pts[2] - pts[0];
+    Point2f d2 = pts[3] - pts[1];
+    float den = d1.x * d2.y - d1.y * d2.x;
+    if (std::abs(den) < 1e-3f) return centroid;
+
+    Point2f w = pts[1] - pts[0];
+    float t = (w.x * d2.y - w.y * d2.x) / den;
+    Point2f center = pts[0] + d1 * t;
+
+    float tol = 0.25f * std::min(br.width, br.height);
+    if (len(center - centroid) > tol) return centroid;
+    return center;
+}
+
+void CornerFinder::scoreHomography(const std::vector<Point2f>& c, const std::vector<Quad>& quads,
+                                   CornerResult& R) const {
+    R.quality = 0.0;
+    if (c.size() != 4) return;
+
+    QuadShape shape = measureQuad(c.data(), (double)outW_ / outH_);
+    R.side_ratio = shape.side_ratio;
+    R.aspect_ratio = shape.aspect_ratio;
+    R.min_angle = shape.min_angle;
+    R.max_angle = shape.max_angle;
+
+    R.marker_size_cv = 0.0;
+    if (quads.size() == 4 && !R.H.empty()) {
+        double sizes[4];
+        for (int k = 0; k < 4; ++k) {
+            std::vector<Point2f> src(quads[k].begin(), quads[k].end()), dst;
+            perspectiveTransform(src, dst, R.H);
+            double s = 0.0;
+            for (int i = 0; i < 4; ++i) s += len(dst[(i + 1) % 4] - dst[i]);
+            sizes[k] = s / 4.0;
+        }
+        R.marker_size_cv = coefficientOfVariation(sizes, 4);
+    }
+
+    R.quality = shapeScore(shape, R.marker_size_cv);
+}
+
 std::vector<Point2f> CornerFinder::orderTLTRBRBL(const std::vector<Point2f>& pts, Point2f C) const {
     if (pts.size() != 4) {
         return pts;
     }
     
-    std::vector<Point2f> sortedPts = pts;
-    
-    std::sort(sortedPts.begin(), sortedPts.end(), [](const Point2f& a, const Point2f& b) {
-        return (a.x + a.y) < (b.x + b.y);
-    });
-    
-    Point2f topLeft = sortedPts[0];
-    Point2f bottomRight = sortedPts[3];
-    
-    std::vector<Point2f> remaining = {sortedPts[1], sortedPts[2]};
-    std::sort(remaining.begin(), remaining.end(), [](const Point2f& a, const Point2f& b) {
-        return (a.y - a.x) < (b.y - b.x);
+    Point2f ordered[4];
+    orderCorners(pts.data(), ordered);
+    return {ordered[0], ordered[1], ordered[2], ordered[3]};
+}
+
+void CornerFinder::collectCandidates(const std::vector<std::vector<Point>>& contours,
+                                     Candidates& out) const {
+    // Area limits of a marker. Since extent >= kMinExtent, the bounding box
+    // of an accepted contour is at most kMaxArea / kMinExtent, which lets the
+    // box alone reject most contours before any area is computed.
+    const double kMinArea = 50, kMaxArea = 15000;
+    const double kMinExtent = 0.65, kMinSolidity = 0.8;
+    const double kMaxBoxArea = kMaxArea / kMinExtent;
+
+    out.clear();
+    std::vector<Point> hull;
+
+    for (size_t k = 0; k < contours.size(); ++k) {
+        const auto& c = contours[k];
+        if (c.size() < 4) continue;
+
+        Rect br = boundingRect(c);
+        double boxArea = br.area();
+        if (boxArea < kMinArea || boxArea > kMaxBoxArea) continue;
+
+        float ar = (float)br.width / br.height;
+        if (ar < 0.7f || ar > 1.4f) continue;
+
+        Moments m = moments(c);
+        double area = std::abs(m.m00);
+        if (area < kMinArea || area > kMaxArea) continue;
+
+        double extent = area / boxArea;
+        if (extent < kMinExtent) continue;
+
+        convexHull(c, hull);
+        double hullArea = contourArea(hull);
+        double solidity = (hullArea > 0) ? area / hullArea : 0.0;
+        if (solidity < kMinSolidity) continue;
+
+        out.contour.push_back(static_cast<int>(k));
+        out.area.push_back(static_cast<float>(area));
+        out.box.push_back(br);
+        out.extent.push_back(static_cast<float>(extent));
+        out.solidity.push_back(static_cast<float>(solidity));
+        out.centroid.emplace_back(static_cast<float>(m.m10 / m.m00),
+                                  static_cast<float>(m.m01 / m.m00));
+    }
+}
+
+bool CornerFinder::selectMarkerSet(const Candidates& cand, Size frame, std::array<int,4>& pick) const {
+    const int kMaxCandidates = 64;
+    const double expectedAspect = (double)outW_ / outH_;
+    const double frameDiag = std::sqrt((double)frame.width * frame.width +
+                                       (double)frame.height * frame.height);
+
+    // Bound the pair count: keep the largest blobs (partial selection).
+    std::vector<int> ids(cand.size());
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<int>(i);
+    if ((int)ids.size() > kMaxCandidates) {
+        std::nth_element(ids.begin(), ids.begin() + kMaxCandidates, ids.end(), [&](int a, int b) {
+            return cand.area[a] > cand.area[b];
+        });
+        ids.resize(kMaxCandidates);
+    }
+
+    std::vector<float> markerSize(cand.size(), 0.0f);
+    for (int i : ids) markerSize[i] = std::sqrt(cand.area[i]);
+
+    // Every page corner pair TL-BR / TR-BL is a diagonal. Two diagonals of
+    // the same page have nearby midpoints and similar lengths, so pairs are
+    // bucketed by (length band, midpoint cell) and only neighbouring buckets
+    // are combined into quadruples.
+    struct Diagonal { int a, b; Point2f mid; float length; int band; };
+    std::vector<Diagonal> diags;
+    diags.reserve(ids.size() * (ids.size() - 1) / 2);
+
+    const double minDiag = 0.2 * frameDiag;
+    const double kLengthRatio = 0.7;
+    const double bandWidth = std::log(1.0 / kLengthRatio);
+    int bands = 1;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        for (size_t j = i + 1; j < ids.size(); ++j) {
+            int a = ids[i], b = ids[j];
+            if (std::min(markerSize[a], markerSize[b]) < 0.6f * std::max(markerSize[a], markerSize[b])) continue;
+
+            Point2f d = cand.centroid[b] - cand.centroid[a];
+            double l = len(d);
+            if (l < minDiag) continue;
+            int band = static_cast<int>(std::log(l / minDiag) / bandWidth);
+            bands = std::max(bands, band + 1);
+            diags.push_back({a, b, (cand.centroid[a] + cand.centroid[b]) * 0.5f, (float)l, band});
+        }
+    }
+
+    // Longest first: the page is usually the largest consistent set, and
+    // finding it early lets the score bound below skip most of the rest.
+    std::sort(diags.begin(), diags.end(), [](const Diagonal& a, const Diagonal& b) {
+        return a.length > b.length;
     });
-    
-    Point2f topRight = remaining[0];
-    Point2f bottomLeft = remaining[1];
-    
-    return {topLeft, topRight, bottomRight, bottomLeft};
+
+    const double cell = 0.05 * frameDiag;
+    const int gw = std::max(1, (int)std::ceil(frame.width / cell));
+    const int gh = std::max(1, (int)std::ceil(frame.height / cell));
+    std::vector<std::vector<int>> buckets(bands * gw * gh);
+    auto bucketOf = [&](int band, int x, int y) { return (band * gh + y) * gw + x; };
+
+    const double frameArea = (double)frame.width * frame.height;
+    double bestScore = 0.0;
+
+    for (int k = 0; k < (int)diags.size(); ++k) {
+        const Diagonal& p = diags[k];
+        int bx = std::clamp((int)(p.mid.x / cell), 0, gw - 1);
+        int by = std::clamp((int)(p.mid.y / cell), 0, gh - 1);
+        double midTol = 0.15 * p.length;
+        int r = static_cast<int>(std::ceil(midTol / cell));
+
+        for (int band = std::max(0, p.band - 1); band <= std::min(bands - 1, p.band + 1); ++band) {
+            for (int y = std::max(0, by - r); y <= std::min(gh - 1, by + r); ++y) {
+                for (int x = std::max(0, bx - r); x <= std::min(gw - 1, bx + r); ++x) {
+                    for (int m : buckets[bucketOf(band, x, y)]) {
+                        const Diagonal& q = diags[m];
+                        if (q.a == p.a || q.a == p.b || q.b == p.a || q.b == p.b) continue;
+                        if (std::min(p.length, q.length) < kLengthRatio * std::max(p.length, q.length)) continue;
+                        if (len(q.mid - p.mid) > midTol) continue;
+
+                        int idx[4] = {p.a, p.b, q.a, q.b};
+                        double sizes[4];
+                        for (int i = 0; i < 4; ++i) sizes[i] = markerSize[idx[i]];
+                        double sizeCv = coefficientOfVariation(sizes, 4);
+
+                        // Ranking: raw deviation from an ideal page (the gate
+                        // ramps saturate). Markers are printed the same size,
+                        // so size spread counts double; a larger page wins
+                        // ties. Skip the shape work if the size term alone
+                        // already rules the set out.
+                        if (sizeCv >= 0.4 || 2.05 - 2.0 * sizeCv <= bestScore) continue;
+
+                        // Equal diagonals meeting at angle t span a rectangle
+                        // of aspect tan(t/2) (or its inverse): a cheap estimate
+                        // of the aspect term, with slack for perspective.
+                        Point2f dp = diags[k].mid - cand.centroid[p.a];
+                        Point2f dq = q.mid - cand.centroid[q.a];
+                        double c = std::abs(dp.x * dq.x + dp.y * dq.y) / std::max(1e-9, len(dp) * len(dq));
+                        double t = std::sqrt((1.0 - c) / (1.0 + c));
+                        double aspectBound = std::max(std::min(t / expectedAspect, expectedAspect / t),
+                                                      std::min(1.0 / (t * expectedAspect), t * expectedAspect));
+                        if (2.05 - 2.0 * sizeCv - std::max(0.0, 0.9 - aspectBound) <= bestScore) continue;
+
+                        Point2f pts[4], ordered[4];
+                        for (int i = 0; i < 4; ++i) pts[i] = cand.centroid[idx[i]];
+                        orderCorners(pts, ordered);
+
+                        QuadShape shape = measureQuad(ordered, expectedAspect, true);
+                        if (shapeScore(shape, sizeCv) <= 0.0) continue;
+
+                        double angleDev = std::max(90.0 - shape.min_angle, shape.max_angle - 90.0) / 90.0;
+                        double err = (1.0 - shape.side_ratio) + (1.0 - shape.aspect_ratio) + angleDev + 2.0 * sizeCv;
+                        double score = 2.0 - err + 0.05 * shape.area / frameArea;
+                        if (score > bestScore) {
+                            bestScore = score;
+                            std::copy(idx, idx + 4, pick.begin());
+                        }
+                    }
+                }
+            }
+        }
+        buckets[bucketOf(p.band, bx, by)].push_back(k);
+    }
+
+    return bestScore > 0.0;
 }
 
-bool CornerFinder::findCornerSquares(const Mat& gray, std::vector<Point2f>& corners, Mat* dbg) const {
+bool CornerFinder::findCornerSquares(const Mat& gray, std::vector<Point2f>& corners,
+                                     std::vector<Quad>& quads, CornerResult& R, Mat* dbg) const {
     Mat th;
     
     GaussianBlur(gray, th, Size(5, 5), 0);
@@ -46,53 +355,39 @@ bool CornerFinder::findCornerSquares(const Mat& gray, std::vector<Point2f>& corn
     std::vector<std::vector<Point>> contours;
     findContours(th, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
     
-    std::vector<std::vector<Point>> candidateContours;
+    Candidates cand;
+    collectCandidates(contours, cand);
+    R.contour_count = static_cast<int>(contours.size());
+    R.candidate_count = static_cast<int>(cand.size());
     
-    for (auto& c : contours) {
-        double area = contourArea(c);
-        if (area < 50 || area > 15000) continue;
-        
-        Rect br = boundingRect(c);
-        float ar = (float)br.width / br.height;
-        if (ar < 0.7f || ar > 1.4f) continue;
-        
-        double extent = area / br.area();
-        if (extent < 0.65) continue;
-        
-        std::vector<Point> hull;
-        convexHull(c, hull);
-        double hullArea = contourArea(hull);
-        double solidity = area / hullArea;
-        if (solidity < 0.8) continue;
-        
-        candidateContours.push_back(c);
+    if (dbg) {
+        for (int k : cand.contour) drawContours(*dbg, contours, k, Scalar(0,255,255), 2);
     }
     
-    if (dbg) drawContours(*dbg, candidateContours, -1, Scalar(0,255,255), 2);
-    
-    if (candidateContours.size() < 4) {
+    if (cand.size() < 4) {
         if (dbg) {
-            std::string msg = "Yeterli aday yok: " + std::to_string(candidateContours.size()) + "/4";
+            std::string msg = "Yeterli aday yok: " + std::to_string(cand.size()) + "/4";
             putText(*dbg, msg, {20,40}, FONT_HERSHEY_SIMPLEX, 0.8, {0,0,255}, 2);
         }
         return false;
     }
     
-    std::sort(candidateContours.begin(), candidateContours.end(), [](auto& a, auto& b) {
-        return contourArea(a) > contourArea(b);
-    });
-    
-    std::vector<std::vector<Point>> finalFour(candidateContours.begin(), 
-                                               candidateContours.begin() + std::min((size_t)4, candidateContours.size()));
+    std::array<int,4> order;
+    if (!selectMarkerSet(cand, gray.size(), order)) {
+        if (dbg) putText(*dbg, "Sayfaya uyan dortlu yok", {20,40}, FONT_HERSHEY_SIMPLEX, 0.8, {0,0,255}, 2);
+        return false;
+    }
     
-    if (dbg) drawContours(*dbg, finalFour, -1, Scalar(0,255,0), 3);
+    if (dbg) {
+        for (int i : order) drawContours(*dbg, contours, cand.contour[i], Scalar(0,255,0), 3);
+    }
     
     std::vector<Point2f> centers;
-    for (auto& c : finalFour) {
-        Moments m = moments(c);
-        if (m.m00 != 0) {
-            centers.push_back(Point2f(m.m10 / m.m00, m.m01 / m.m00));
-        }
+    std::vector<Quad> markerQuads;
+    for (int i : order) {
+        Quad q;
+        centers.push_back(refineMarker(gray, contours[cand.contour[i]], cand.centroid[i], q));
+        markerQuads.push_back(q);
     }
     
     if (centers.size() != 4) {
@@ -101,6 +396,12 @@ bool CornerFinder::findCornerSquares(const Mat& gray, std::vector<Point2f>& corn
     }
     
     corners = orderTLTRBRBL(centers, Point2f(gray.cols / 2.f, gray.rows / 2.f));
+
+    quads.clear();
+    for (const auto& p : corners) {
+        size_t k = std::find(centers.begin(), centers.end(), p) - centers.begin();
+        quads.push_back(markerQuads[k]);
+    }
     
     if (dbg) {
         std::vector<std::string> labels = {"TL", "TR", "BR", "BL"};
@@ -125,21 +426,82 @@ bool CornerFinder::findCornerSquares(const Mat& gray, std::vector<Point2f>& corn
     return true;
 }
 
-CornerResult CornerFinder::processFrame(const Mat& bgr, bool debug_on) const {
+void CornerFinder::setOrientationLayout(const std::vector<Rect>& pageRects) {
+    layoutMask_.release();
+    if (pageRects.empty()) return;
+
+    layoutMask_ = Mat::zeros(outH_ / kLayoutScale, outW_ / kLayoutScale, CV_8UC1);
+    for (const Rect& r : pageRects) {
+        Rect s(r.x / kLayoutScale, r.y / kLayoutScale, r.width / kLayoutScale, r.height / kLayoutScale);
+        layoutMask_(s & Rect(0, 0, layoutMask_.cols, layoutMask_.rows)).setTo(Scalar(255));
+    }
+    bitwise_not(layoutMask_, layoutMaskInv_);
+}
+
+double CornerFinder::layoutScore(const Mat& gray, const std::vector<Point2f>& pageOrder) const {
+    const float w = (float)layoutMask_.cols, h = (float)layoutMask_.rows;
+    std::vector<Point2f> dst = {{0, 0}, {w - 1, 0}, {w - 1, h - 1}, {0, h - 1}};
+
+    Mat thumb;
+    warpPerspective(gray, thumb, getPerspectiveTransform(pageOrder, dst), layoutMask_.size(),
+                    INTER_LINEAR, BORDER_REPLICATE);
+
+    // Printed bubble grids put more ink inside the read regions than on the
+    // rest of the sheet; a wrong turn moves the regions onto blank paper.
+    return mean(thumb, layoutMaskInv_)[0] - mean(thumb, layoutMask_)[0];
+}
+
+int CornerFinder::detectOrientation(const Mat& gray, const std::vector<Point2f>& imageOrder,
+                                    double* margin) const {
+    if (margin) *margin = 0.0;
+
+    // Portrait or lying on its side: from the image-space aspect alone.
+    QuadShape upright = measureQuad(imageOrder.data(), (double)outW_ / outH_);
+    QuadShape turned = measureQuad(imageOrder.data(), (double)outH_ / outW_);
+    int base = (turned.aspect_ratio > upright.aspect_ratio) ? 1 : 0;
+
+    if (layoutMask_.empty()) return base;
+
+    // Upside down or not: from the page layout.
+    double s0 = layoutScore(gray, rotateOrder(imageOrder, base));
+    double s2 = layoutScore(gray, rotateOrder(imageOrder, base + 2));
+    if (margin) *margin = std::abs(s0 - s2);
+    return (s2 > s0) ? base + 2 : base;
+}
+
+std::vector<Point2f> CornerFinder::rotateOrder(const std::vector<Point2f>& imageOrder, int turns) {
+    std::vector<Point2f> out(4);
+    for (int j = 0; j < 4; ++j) out[j] = imageOrder[(j + turns) % 4];
+    return out;
+}
+
+CornerResult CornerFinder::processFrame(const Mat& bgr, bool debug_on, bool warp_page) const {
     CornerResult R;
     if (bgr.empty()) return R;
     
     Mat gray;
     cvtColor(bgr, gray, COLOR_BGR2GRAY);
+    R.source_gray = gray;
     
     std::vector<Point2f> srcPoints;
+    std::vector<Quad> quads;
     Mat dbgImg;
-    R.paper_ok = findCornerSquares(gray, srcPoints, debug_on ? &dbgImg : nullptr);
+    R.paper_ok = findCornerSquares(gray, srcPoints, quads, R, debug_on ? &dbgImg : nullptr);
     
     if (debug_on) R.debug_bgr = dbgImg;
     
     if (!R.paper_ok) return R;
     
+    // The page turn is applied by cycling which marker maps to which page
+    // corner, so the frame itself is never rotated.
+    R.orientation = detectOrientation(gray, srcPoints, &R.orientation_margin);
+    if (R.orientation != 0) {
+        srcPoints = rotateOrder(srcPoints, R.orientation);
+        std::vector<Quad> turned(4);
+        for (int j = 0; j < 4; ++j) turned[j] = quads[(j + R.orientation) % 4];
+        quads.swap(turned);
+    }
+    
     std::vector<Point2f> dstPoints = {
         {0, 0},
         {(float)outW_ - 1, 0},
@@ -147,14 +509,27 @@ CornerResult CornerFinder::processFrame(const Mat& bgr, bool debug_on) const {
         {0, (float)outH_ - 1}
     };
     
-    Mat H = getPerspectiveTransform(srcPoints, dstPoints);
-    
-    warpPerspective(gray, R.warped_gray, H, 
-                    Size(outW_, outH_), 
-                    INTER_LINEAR,
-                    BORDER_REPLICATE);
-    
+    R.H = getPerspectiveTransform(srcPoints, dstPoints);
     for(int i=0; i<4; ++i) R.markers_orig[i] = srcPoints[i];
+
+    scoreHomography(srcPoints, quads, R);
+    if (debug_on) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "Kalite: %.2f", R.quality);
+        putText(dbgImg, buf, {20, 100}, FONT_HERSHEY_SIMPLEX, 0.8,
+                R.quality >= minQuality_ ? Scalar(0,255,0) : Scalar(0,0,255), 2);
+    }
+    if (R.quality < minQuality_) {
+        R.paper_ok = false;
+        return R;
+    }
+    
+    if (warp_page) {
+        warpPerspective(gray, R.warped_gray, R.H, 
+                        Size(outW_, outH_), 
+                        INTER_LINEAR,
+                        BORDER_REPLICATE);
+    }
     
     return R;
 }
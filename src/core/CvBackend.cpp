@@ -0,0 +1,37 @@
+#include "core/CvBackend.hpp"
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
+#include <thread>
+
+namespace core {
+
+int cpuCount() {
+    int n = cv::getNumberOfCPUs();
+    if (n <= 0) n = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, n);
+}
+
+int autoCvThreads(int workers, bool sharedProcess) {
+    workers = std::max(1, workers);
+    if (sharedProcess) return workers > 1 ? 1 : cpuCount();
+    return std::max(1, cpuCount() / workers);
+}
+
+void applyCvBudget(const CvBudget& budget) {
+    cv::ocl::setUseOpenCL(budget.useOpenCL);
+    cv::setNumThreads(budget.cvThreads > 0 ? budget.cvThreads : cpuCount());
+}
+
+ScopedCvThreads::ScopedCvThreads(int n) {
+    if (n <= 0) return;
+    saved_ = cv::getNumThreads();
+    if (saved_ != n) cv::setNumThreads(n);
+    else saved_ = -1;
+}
+
+ScopedCvThreads::~ScopedCvThreads() {
+    if (saved_ >= 0) cv::setNumThreads(saved_);
+}
+
+}
@@ -0,0 +1,367 @@
+#include "core/ExamStats.hpp"
+#include "core/MappedImageSource.hpp"
+#include "core/TaskPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace core {
+
+void ExamStats::Moments::add(double v) {
+    if (n == 0 || v < min) min = v;
+    if (n == 0 || v > max) max = v;
+    n++;
+    sum += v;
+    sumSq += v * v;
+}
+
+void ExamStats::Moments::merge(const Moments& o) {
+    if (o.n == 0) return;
+    if (n == 0 || o.min < min) min = o.min;
+    if (n == 0 || o.max > max) max = o.max;
+    n += o.n;
+    sum += o.sum;
+    sumSq += o.sumSq;
+}
+
+double ExamStats::Moments::stddev() const {
+    if (n == 0) return 0.0;
+    double m = sum / n;
+    return std::sqrt(std::max(0.0, sumSq / n - m * m));
+}
+
+ExamStats::ExamStats(const AnswerKey& key, char booklet)
+    : booklet_(key.hasBooklet(booklet) ? booklet : key.defaultBooklet()) {
+    const AnswerKey::CompiledKey& compiled = key.compiled(booklet_);
+    for (const auto& rule : compiled.subjects) {
+        Subject s;
+        s.name = rule.name;
+        s.firstItem = items_.size();
+        s.questions = rule.count;
+        s.rule = rule;
+        for (int q = 0; q < s.questions; ++q) {
+            Item item;
+            item.accept = compiled.accept[rule.first + q];
+            item.cancelled = compiled.cancelled[rule.first + q] != 0;
+            items_.push_back(item);
+        }
+        subjects_.push_back(s);
+    }
+}
+
+void ExamStats::clear() {
+    for (Item& item : items_) {
+        Item fresh;
+        fresh.accept = item.accept;
+        fresh.cancelled = item.cancelled;
+        item = fresh;
+    }
+    for (Subject& s : subjects_) {
+        s.net = Moments();
+        s.correct = s.wrong = s.empty = 0;
+    }
+    total_ = Moments();
+    sheets_ = 0;
+    unread_ = 0;
+}
+
+int ExamStats::subjectIndex(const std::string& name) const {
+    for (size_t i = 0; i < subjects_.size(); ++i)
+        if (subjects_[i].name == name) return static_cast<int>(i);
+    return -1;
+}
+
+void ExamStats::add(const std::map<std::string, AnswerVector>& answers) {
+    std::vector<AnswerVector> bySubject(subjects_.size());
+    for (const auto& kv : answers) {
+        int s = subjectIndex(kv.first);
+        if (s >= 0) bySubject[s] = kv.second;
+    }
+    add(bySubject);
+}
+
+void ExamStats::add(const std::vector<AnswerVector>& bySubject) {
+    static const AnswerVector noAnswers;
+
+    // Totals first: every item's discrimination needs this sheet's net.
+    double totalNet = 0.0;
+    for (size_t s = 0; s < subjects_.size(); ++s) {
+        Subject& subj = subjects_[s];
+        const AnswerVector& student = s < bySubject.size() ? bySubject[s] : noAnswers;
+
+        int correct = 0, wrong = 0;
+        for (int q = 0; q < subj.questions; ++q) {
+            const Item& item = items_[subj.firstItem + q];
+            uint8_t code = student[q];
+            if (scores(item, code)) correct++;
+            else if (AnswerVector::isAnswer(code)) wrong++;
+        }
+        int empty = subj.questions - correct - wrong;
+
+        double net = subj.rule.net(correct, wrong);
+        subj.net.add(net);
+        subj.correct += correct;
+        subj.wrong += wrong;
+        subj.empty += empty;
+        totalNet += net;
+    }
+    total_.add(totalNet);
+    sheets_++;
+
+    for (size_t s = 0; s < subjects_.size(); ++s) {
+        const Subject& subj = subjects_[s];
+        const AnswerVector& student = s < bySubject.size() ? bySubject[s] : noAnswers;
+
+        for (int q = 0; q < subj.questions; ++q) {
+            Item& item = items_[subj.firstItem + q];
+            uint8_t code = student[q];
+
+            if (code < kOptions) item.options[code]++;
+            else if (code == AnswerVector::Blank) item.blank++;
+            else if (code == AnswerVector::Multi) item.multi++;
+            else if (code == AnswerVector::Uncertain) item.uncertain++;
+            else item.other++;
+
+            if (scores(item, code)) {
+                item.correct++;
+                item.totalWhenCorrect += totalNet;
+            }
+        }
+    }
+}
+
+void ExamStats::merge(const ExamStats& other) {
+    if (other.items_.size() != items_.size() || other.subjects_.size() != subjects_.size()) return;
+
+    for (size_t i = 0; i < items_.size(); ++i) {
+        Item& a = items_[i];
+        const Item& b = other.items_[i];
+        for (int o = 0; o < kOptions; ++o) a.options[o] += b.options[o];
+        a.other += b.other;
+        a.blank += b.blank;
+        a.multi += b.multi;
+        a.uncertain += b.uncertain;
+        a.correct += b.correct;
+        a.totalWhenCorrect += b.totalWhenCorrect;
+    }
+    for (size_t s = 0; s < subjects_.size(); ++s) {
+        Subject& a = subjects_[s];
+        const Subject& b = other.subjects_[s];
+        a.net.merge(b.net);
+        a.correct += b.correct;
+        a.wrong += b.wrong;
+        a.empty += b.empty;
+    }
+    total_.merge(other.total_);
+    sheets_ += other.sheets_;
+    unread_ += other.unread_;
+}
+
+nlohmann::json ExamStats::toJson() const {
+    auto moments = [](const Moments& m) {
+        return nlohmann::json{
+            {"mean", m.mean()}, {"sd", m.stddev()}, {"min", m.min}, {"max", m.max}
+        };
+    };
+
+    nlohmann::json j;
+    j["booklet"] = std::string(1, booklet_);
+    j["sheets"] = sheets_;
+    j["unread"] = unread_;
+    j["net"] = moments(total_);
+
+    const double n = static_cast<double>(sheets_);
+    const double sd = total_.stddev();
+
+    nlohmann::json subjects = nlohmann::json::object();
+    for (const Subject& s : subjects_) {
+        nlohmann::json sj = moments(s.net);
+        sj["questions"] = s.questions;
+        sj["correct"] = s.correct;
+        sj["wrong"] = s.wrong;
+        sj["empty"] = s.empty;
+
+        nlohmann::json items = nlohmann::json::array();
+        for (int q = 0; q < s.questions; ++q) {
+            const Item& item = items_[s.firstItem + q];
+            nlohmann::json ij;
+            ij["question"] = q + 1;
+            std::string keyText;
+            int last = -1;
+            for (int o = 0; o < 26; ++o) {
+                if (!((item.accept >> o) & 1u)) continue;
+                keyText.push_back(static_cast<char>('A' + o));
+                if (o < kOptions) last = o;
+            }
+            ij["key"] = keyText;
+            if (item.cancelled) ij["cancelled"] = true;
+
+            for (int o = 0; o < kOptions; ++o)
+                if (item.options[o]) last = std::max(last, o);
+            nlohmann::json options = nlohmann::json::object();
+            for (int o = 0; o <= last; ++o)
+                options[std::string(1, static_cast<char>('A' + o))] = item.options[o];
+            ij["options"] = options;
+            ij["blank"] = item.blank;
+            ij["multi"] = item.multi;
+            ij["uncertain"] = item.uncertain;
+            if (item.other) ij["other"] = item.other;
+
+            double p = n > 0 ? item.correct / n : 0.0;
+            ij["difficulty"] = p;
+
+            // Point-biserial r = (M1 - M0) / sd * sqrt(p * q); undefined when
+            // everyone (or no one) got the item right or all totals are equal.
+            if (item.correct > 0 && item.correct < sheets_ && sd > 0.0) {
+                double m1 = item.totalWhenCorrect / item.correct;
+                double m0 = (total_.sum - item.totalWhenCorrect) / (sheets_ - item.correct);
+                ij["discrimination"] = (m1 - m0) / sd * std::sqrt(p * (1.0 - p));
+            } else {
+                ij["discrimination"] = nullptr;
+            }
+            items.push_back(ij);
+        }
+        sj["items"] = items;
+        subjects[s.name] = sj;
+    }
+    j["subjects"] = subjects;
+    return j;
+}
+
+namespace {
+
+char scanBooklet(const char* b, const char* e) {
+    static const char kTag[] = "\"booklet\":\"";
+    const size_t tagLen = sizeof(kTag) - 1;
+    const char* p = std::search(b, e, kTag, kTag + tagLen);
+    return (p != e && p + tagLen < e) ? p[tagLen] : 0;
+}
+
+// Reads the "answers" object of one result line as written by
+// SheetPipeline::toJson (compact dump: "answers":{"fen":"A,-,X",...}).
+// Returns false if the line does not have that shape.
+bool scanAnswers(const char* b, const char* e, const ExamStats& stats,
+                 std::vector<AnswerVector>& bySubject, bool& ok) {
+    static const char kTag[] = "\"answers\":{";
+    const size_t tagLen = sizeof(kTag) - 1;
+
+    const char* p = std::search(b, e, kTag, kTag + tagLen);
+    if (p == e) {
+        static const char kFailed[] = "\"ok\":false";
+        ok = false;
+        return std::search(b, e, kFailed, kFailed + sizeof(kFailed) - 1) != e;
+    }
+    ok = true;
+    p += tagLen;
+
+    for (auto& v : bySubject) v.clear();
+    while (p < e && *p != '}') {
+        if (*p == ',') { ++p; continue; }
+        if (*p != '"') return false;
+        const char* nameEnd = static_cast<const char*>(std::memchr(p + 1, '"', e - p - 1));
+        if (!nameEnd || nameEnd + 2 >= e || nameEnd[1] != ':' || nameEnd[2] != '"') return false;
+        int s = stats.subjectIndex(std::string(p + 1, nameEnd));
+
+        const char* v = nameEnd + 3;
+        const char* vEnd = static_cast<const char*>(std::memchr(v, '"', e - v));
+        if (!vEnd) return false;
+        if (s >= 0) {
+            AnswerVector& out = bySubject[s];
+            for (const char* c = v; c < vEnd; ++c)
+                if (*c != ',') out.push(AnswerVector::fromChar(*c));
+        }
+        p = vEnd + 1;
+    }
+    return p < e;
+}
+
+bool parseAnswers(const char* b, const char* e, const ExamStats& stats,
+                  std::vector<AnswerVector>& bySubject, bool& ok) {
+    if (scanAnswers(b, e, stats, bySubject, ok)) return true;
+
+    nlohmann::json j = nlohmann::json::parse(b, e, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return false;
+
+    ok = j.value("ok", false);
+    for (auto& v : bySubject) v.clear();
+    auto it = j.find("answers");
+    if (!ok || it == j.end() || !it->is_object()) return true;
+
+    for (const auto& kv : it->items()) {
+        int s = stats.subjectIndex(kv.key());
+        if (s < 0 || !kv.value().is_string()) continue;
+        for (char c : kv.value().get<std::string>())
+            if (c != ',') bySubject[s].push(AnswerVector::fromChar(c));
+    }
+    return true;
+}
+
+}
+
+size_t ExamStats::addResultFiles(const std::vector<std::string>& paths, int threads,
+                                 std::vector<ExamStats>& out) {
+    if (out.empty()) return 0;
+    threads = std::max(1, threads);
+    TaskPool pool(threads);
+    size_t bad = 0;
+
+    for (const auto& path : paths) {
+        MappedFile file;
+        if (!file.open(path)) {
+            bad++;
+            continue;
+        }
+        const char* data = reinterpret_cast<const char*>(file.data());
+        const size_t size = file.size();
+
+        // Chunks end on line boundaries; each is aggregated on its own copy.
+        const size_t chunks = std::min<size_t>(std::max<size_t>(1, size / (1 << 20)), threads * 4);
+        std::vector<size_t> cut(chunks + 1, size);
+        cut[0] = 0;
+        for (size_t c = 1; c < chunks; ++c) {
+            size_t at = std::max(cut[c - 1], size * c / chunks);
+            const void* nl = at < size ? std::memchr(data + at, '\n', size - at) : nullptr;
+            cut[c] = nl ? static_cast<size_t>(static_cast<const char*>(nl) - data) + 1 : size;
+        }
+
+        std::vector<std::vector<ExamStats>> partial(chunks, out);
+        std::vector<size_t> partialBad(chunks, 0);
+        for (auto& set : partial)
+            for (auto& p : set) p.clear();
+
+        pool.parallelFor(static_cast<int>(chunks), [&](int c) {
+            std::vector<ExamStats>& set = partial[c];
+            std::vector<AnswerVector> bySubject;
+
+            const char* p = data + cut[c];
+            const char* end = data + cut[c + 1];
+            while (p < end) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                const char* lineEnd = nl ? nl : end;
+                if (lineEnd > p) {
+                    char booklet = scanBooklet(p, lineEnd);
+                    ExamStats* pick = &set[0];
+                    for (auto& s : set)
+                        if (s.booklet_ == booklet) pick = &s;
+                    ExamStats& stats = *pick;
+                    bySubject.resize(stats.subjects_.size());
+
+                    bool ok = false;
+                    if (!parseAnswers(p, lineEnd, stats, bySubject, ok)) partialBad[c]++;
+                    else if (ok) stats.add(bySubject);
+                    else stats.addUnread();
+                }
+                p = lineEnd + 1;
+            }
+        });
+
+        for (size_t c = 0; c < chunks; ++c) {
+            for (size_t k = 0; k < out.size(); ++k) out[k].merge(partial[c][k]);
+            bad += partialBad[c];
+        }
+    }
+    return bad;
+}
+
+}
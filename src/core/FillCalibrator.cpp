@@ -0,0 +1,55 @@
+#include "core/FillCalibrator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+void FillCalibrator::add(const float* ratios, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float v = std::min(1.0f, std::max(0.0f, ratios[i]));
+        int b = std::min(kBins - 1, static_cast<int>(v * kBins));
+        hist_[b]++;
+        sum_[b] += v;
+    }
+    count_ += n;
+}
+
+void FillCalibrator::reset() {
+    hist_.fill(0);
+    sum_.fill(0.0);
+    count_ = 0;
+}
+
+FillSplit FillCalibrator::split(double seed, double minSeparation) const {
+    FillSplit out;
+    if (count_ < 2) return out;
+
+    // Iterative two-means: t <- midpoint of the class means, starting from
+    // the prior cut. Unlike a plain Otsu split this does not drift into the
+    // blank class when only a handful of cells are marked.
+    double t = seed;
+    for (int iter = 0; iter < 20; ++iter) {
+        double n0 = 0.0, s0 = 0.0, n1 = 0.0, s1 = 0.0;
+        for (int b = 0; b < kBins; ++b) {
+            if (hist_[b] == 0) continue;
+            if (sum_[b] / hist_[b] >= t) { n1 += hist_[b]; s1 += sum_[b]; }
+            else                         { n0 += hist_[b]; s0 += sum_[b]; }
+        }
+        if (n0 == 0.0 || n1 == 0.0) return out;
+
+        out.unmarkedMean = s0 / n0;
+        out.markedMean = s1 / n1;
+        out.marked = static_cast<int>(n1);
+
+        double next = 0.5 * (out.unmarkedMean + out.markedMean);
+        bool done = std::abs(next - t) < 1e-4;
+        t = next;
+        if (done) break;
+    }
+
+    out.threshold = t;
+    out.ok = (out.markedMean - out.unmarkedMean) >= minSeparation;
+    return out;
+}
+
+}
@@ -0,0 +1,99 @@
+#include "core/FillTensorFile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace core {
+
+struct FillTensorFile::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t recordBytes;
+    uint32_t cellsPerSheet;
+    uint64_t sheetCount;
+    uint32_t regionCount;
+    unsigned char pad[28];
+};
+
+namespace {
+
+const char kMagic[8] = {'O', 'M', 'R', 'F', 'I', 'L', 'L', 'S'};
+const uint32_t kVersion = 1;
+const size_t kRecordPrefix = 4;
+
+void put16(std::vector<unsigned char>& out, uint16_t v) {
+    out.push_back(static_cast<unsigned char>(v & 0xFF));
+    out.push_back(static_cast<unsigned char>(v >> 8));
+}
+
+unsigned char quantize(double v) {
+    return static_cast<unsigned char>(std::lround(std::min(1.0, std::max(0.0, v)) * 255.0));
+}
+
+}
+
+bool FillTensorFile::open(const std::string& path, size_t sheetCount, const std::vector<Region>& layout,
+                          bool keep) {
+    static_assert(sizeof(Header) == 64, "fill tensor header layout");
+
+    file_.close();
+
+    std::vector<unsigned char> table;
+    cells_ = 0;
+    for (const Region& r : layout) {
+        put16(table, static_cast<uint16_t>(r.rows));
+        put16(table, static_cast<uint16_t>(r.cols));
+        size_t n = std::min<size_t>(r.name.size(), 255);
+        table.push_back(static_cast<unsigned char>(n));
+        table.insert(table.end(), r.name.begin(), r.name.begin() + n);
+        cells_ += static_cast<size_t>(r.rows) * r.cols;
+    }
+
+    sheets_ = sheetCount;
+    headerBytes_ = (sizeof(Header) + table.size() + 63) / 64 * 64;
+    recordBytes_ = kRecordPrefix + cells_;
+    const size_t bytes = headerBytes_ + sheets_ * recordBytes_;
+
+    if (!file_.openReadWrite(path, bytes)) return false;
+
+    unsigned char* base = file_.mutableData();
+    Header* h = reinterpret_cast<Header*>(base);
+    bool same = keep && std::memcmp(h->magic, kMagic, 8) == 0 && h->version == kVersion &&
+                h->headerBytes == headerBytes_ && h->recordBytes == recordBytes_ &&
+                h->sheetCount == sheets_ && h->regionCount == layout.size() &&
+                std::memcmp(base + sizeof(Header), table.data(), table.size()) == 0;
+
+    if (!same) {
+        std::memset(base, 0, bytes);
+        std::memcpy(h->magic, kMagic, 8);
+        h->version = kVersion;
+        h->headerBytes = static_cast<uint32_t>(headerBytes_);
+        h->recordBytes = static_cast<uint32_t>(recordBytes_);
+        h->cellsPerSheet = static_cast<uint32_t>(cells_);
+        h->sheetCount = sheets_;
+        h->regionCount = static_cast<uint32_t>(layout.size());
+        std::memcpy(base + sizeof(Header), table.data(), table.size());
+    }
+    return true;
+}
+
+void FillTensorFile::write(size_t index, Status status, const std::vector<float>& cells,
+                           double answerThreshold, bool calibrated, int orientation) {
+    if (!file_.isOpen() || index >= sheets_) return;
+
+    unsigned char* rec = file_.mutableData() + headerBytes_ + index * recordBytes_;
+    rec[1] = quantize(answerThreshold);
+    rec[2] = calibrated ? 1 : 0;
+    rec[3] = static_cast<unsigned char>(orientation & 3);
+
+    unsigned char* out = rec + kRecordPrefix;
+    const size_t n = std::min(cells.size(), cells_);
+    for (size_t i = 0; i < n; ++i) out[i] = quantize(cells[i]);
+    std::memset(out + n, 0, cells_ - n);
+
+    // Status last: a record only reads as Measured once its cells are in.
+    rec[0] = status;
+}
+
+}
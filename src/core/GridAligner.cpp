@@ -0,0 +1,135 @@
+#include "core/GridAligner.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+namespace {
+
+// Half-widths, in pitches, of the window around a cell centre (bubble) and
+// of the one around a cell boundary (paper between bubbles). Boundaries stay
+// white whether the printed bubbles are outlines, lettered or filled.
+const double kCentreBand = 0.35;
+const double kEdgeBand = 0.1;
+// Pitch search step, as a fraction of the nominal pitch.
+const double kScaleStep = 0.005;
+// An aligned lattice must beat the nominal one and show at least this much
+// contrast (mean gray levels, boundaries minus centres) to be used.
+const double kMinContrast = 3.0;
+// Cost of moving away from the nominal lattice, in gray levels per pitch
+// of shift and per full maxScale of pitch change.
+const double kDrift = 0.5;
+
+void prefixSums(const cv::Mat& profile, std::vector<int64_t>& prefix) {
+    const int n = static_cast<int>(profile.total());
+    const int* p = profile.ptr<int>(0);
+    prefix.assign(n + 1, 0);
+    for (int i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + p[i];
+}
+
+// Adds the profile over [at - half, at + half) to sum/count.
+void window(const std::vector<int64_t>& prefix, double at, double half, int64_t& sum, int& count) {
+    const int n = static_cast<int>(prefix.size()) - 1;
+    const int a = std::max(0, static_cast<int>(std::lround(at - half)));
+    const int b = std::min(n, static_cast<int>(std::lround(at + half)));
+    if (b <= a) return;
+    sum += prefix[b] - prefix[a];
+    count += b - a;
+}
+
+// Mean profile at the cell boundaries minus that at the cell centres.
+double latticeContrast(const std::vector<int64_t>& prefix, double start, double pitch, int cells) {
+    const double n = static_cast<double>(prefix.size() - 1);
+    if (start < 0.0 || start + pitch * cells > n) return -1e9;
+
+    const double centreHalf = std::max(0.5, kCentreBand * pitch);
+    const double edgeHalf = std::max(0.5, kEdgeBand * pitch);
+    int64_t centreSum = 0, edgeSum = 0;
+    int centreN = 0, edgeN = 0;
+    for (int c = 0; c < cells; ++c) {
+        window(prefix, start + (c + 0.5) * pitch, centreHalf, centreSum, centreN);
+        window(prefix, start + c * pitch, edgeHalf, edgeSum, edgeN);
+    }
+    window(prefix, start + cells * pitch, edgeHalf, edgeSum, edgeN);
+
+    if (centreN == 0 || edgeN == 0) return -1e9;
+    return static_cast<double>(edgeSum) / edgeN - static_cast<double>(centreSum) / centreN;
+}
+
+}
+
+cv::Rect GridAligner::searchArea(const cv::Rect& nominal, int rows, int cols, const cv::Size& page) const {
+    auto margin = [&](int len, int cells) {
+        double pitch = static_cast<double>(len) / std::max(1, cells);
+        return static_cast<int>(std::ceil(maxShift_ * pitch + maxScale_ * len * 0.5)) + 1;
+    };
+    const int mx = margin(nominal.width, cols);
+    const int my = margin(nominal.height, rows);
+    cv::Rect area(nominal.x - mx, nominal.y - my, nominal.width + 2 * mx, nominal.height + 2 * my);
+    return area & cv::Rect(0, 0, page.width, page.height);
+}
+
+void GridAligner::alignAxis(const std::vector<int64_t>& prefix, double depth, int cells,
+                            int& start, int& length) const {
+    const double pitch0 = static_cast<double>(length) / cells;
+    const double centre0 = start + length * 0.5;
+    const int maxShiftPx = static_cast<int>(std::lround(maxShift_ * pitch0));
+    const int steps = static_cast<int>(std::lround(maxScale_ / kScaleStep));
+
+    const double nominal = latticeContrast(prefix, start, pitch0, cells) / depth;
+    double best = nominal;
+    double bestPitch = pitch0;
+    double bestCentre = centre0;
+
+    for (int k = -steps; k <= steps; ++k) {
+        const double pitch = pitch0 * (1.0 + k * kScaleStep);
+        const double scaleCost = steps ? kDrift * std::abs(k) / steps : 0.0;
+        for (int d = -maxShiftPx; d <= maxShiftPx; ++d) {
+            if (k == 0 && d == 0) continue;
+            const double centre = centre0 + d;
+            double score = latticeContrast(prefix, centre - pitch * cells * 0.5, pitch, cells) / depth
+                           - scaleCost - kDrift * std::abs(d) / pitch0;
+            if (score > best) {
+                best = score;
+                bestPitch = pitch;
+                bestCentre = centre;
+            }
+        }
+    }
+
+    if (best <= nominal || best < kMinContrast) return;
+    start = static_cast<int>(std::lround(bestCentre - bestPitch * cells * 0.5));
+    length = std::max(cells, static_cast<int>(std::lround(bestPitch * cells)));
+}
+
+cv::Rect GridAligner::align(const cv::Mat& gray, const cv::Rect& nominal, int rows, int cols) const {
+    CV_Assert(gray.type() == CV_8UC1);
+    if (rows <= 0 || cols <= 0 || nominal.width < cols || nominal.height < rows) return nominal;
+
+    const cv::Rect area = searchArea(nominal, rows, cols, gray.size());
+    if ((nominal & area) != nominal) return nominal;
+
+    std::vector<int64_t> prefix;
+    cv::Mat profile;
+
+    // Columns: summed over the nominal rows only.
+    cv::reduce(gray(cv::Rect(area.x, nominal.y, area.width, nominal.height)), profile, 0,
+               cv::REDUCE_SUM, CV_32S);
+    prefixSums(profile, prefix);
+    int x = nominal.x - area.x, w = nominal.width;
+    alignAxis(prefix, nominal.height, cols, x, w);
+
+    // Rows: summed over the aligned columns.
+    cv::Rect colSpan(area.x + x, area.y, w, area.height);
+    colSpan &= area;
+    if (colSpan.width <= 0) return nominal;
+    cv::reduce(gray(colSpan), profile, 1, cv::REDUCE_SUM, CV_32S);
+    prefixSums(profile, prefix);
+    int y = nominal.y - area.y, h = nominal.height;
+    alignAxis(prefix, colSpan.width, rows, y, h);
+
+    cv::Rect aligned(area.x + x, area.y + y, w, h);
+    return aligned & area;
+}
+
+}
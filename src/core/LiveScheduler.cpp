@@ -0,0 +1,71 @@
+#include "core/LiveScheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+namespace {
+
+// Weight of the newest sample in the running cost averages.
+const double kAlpha = 0.2;
+
+}
+
+LiveScheduler::LiveScheduler(double frameMs, int maxSkip)
+    : frameMs_(frameMs > 0.0 ? frameMs : 1000.0 / 30.0),
+      maxSkip_(std::max(1, maxSkip)) {}
+
+void LiveScheduler::setFrameInterval(double ms) {
+    if (ms > 0.0) frameMs_ = ms;
+}
+
+void LiveScheduler::reset() {
+    baseMs_ = warpMs_ = readMs_ = 0.0;
+    measuredBase_ = measuredWarp_ = measuredRead_ = false;
+    credit_ = 0.0;
+    sinceRead_ = 0;
+}
+
+void LiveScheduler::smooth(double& avg, bool& seeded, double sample) {
+    avg = seeded ? avg + kAlpha * (sample - avg) : sample;
+    seeded = true;
+}
+
+LiveScheduler::Stage LiveScheduler::plan(bool wantRead, bool wantPage) {
+    // A frame that runs a stage costs base + stage; it fits if the time
+    // saved so far covers its overrun past one frame interval.
+    const double slack = frameMs_ - baseMs_;
+
+    // While reads are wanted a warp-only frame would spend the time saved
+    // for the next read, so the page alone is only refreshed otherwise.
+    if (wantRead) {
+        bool due = !measuredRead_ || sinceRead_ + 1 >= maxSkip_ ||
+                   credit_ + slack >= warpMs_ + readMs_;
+        return due ? Stage::Read : Stage::Corners;
+    }
+    if (wantPage && (!measuredWarp_ || credit_ + slack >= warpMs_)) {
+        return Stage::Warp;
+    }
+    return Stage::Corners;
+}
+
+void LiveScheduler::record(double warpMs, double readMs, double totalMs) {
+    if (readMs > 0.0) smooth(readMs_, measuredRead_, readMs);
+    if (warpMs > 0.0) smooth(warpMs_, measuredWarp_, warpMs);
+    smooth(baseMs_, measuredBase_, std::max(0.0, totalMs - warpMs - readMs));
+
+    sinceRead_ = (readMs > 0.0) ? 0 : sinceRead_ + 1;
+
+    // Saved time is capped at one read so a pause does not turn into a
+    // burst of back-to-back reads; debt is bounded by the forced read.
+    credit_ += frameMs_ - totalMs;
+    credit_ = std::clamp(credit_, -(warpMs_ + readMs_) * maxSkip_, warpMs_ + readMs_);
+}
+
+double LiveScheduler::readEvery() const {
+    const double slack = frameMs_ - baseMs_;
+    if (slack <= 0.0) return maxSkip_;
+    return std::clamp((warpMs_ + readMs_) / slack, 1.0, static_cast<double>(maxSkip_));
+}
+
+}
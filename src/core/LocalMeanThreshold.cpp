@@ -0,0 +1,58 @@
+#include "core/LocalMeanThreshold.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace core {
+
+void LocalMeanThreshold::prepare(const cv::Mat& gray, int blur) {
+    CV_Assert(gray.type() == CV_8UC1);
+    if (blur > 1)
+        cv::GaussianBlur(gray, smooth_, cv::Size(blur, blur), 0);
+    else
+        gray.copyTo(smooth_);
+    cv::integral(smooth_, sum_, CV_32S);
+}
+
+void LocalMeanThreshold::clear() {
+    smooth_.release();
+    sum_.release();
+}
+
+void LocalMeanThreshold::binarizeInv(const cv::Rect& roi, int block, double C, cv::Mat& dst) const {
+    CV_Assert(ready() && block >= 3 && (block & 1));
+    const cv::Rect r = roi & cv::Rect(0, 0, smooth_.cols, smooth_.rows);
+    dst.create(r.size(), CV_8UC1);
+    if (r.empty()) return;
+
+    const int half = block / 2;
+    const int idelta = static_cast<int>(std::floor(C));
+
+    // Window column bounds are the same for every row.
+    std::vector<int> x0(r.width), x1(r.width);
+    for (int i = 0; i < r.width; ++i) {
+        x0[i] = std::max(r.x, r.x + i - half);
+        x1[i] = std::min(r.x + r.width, r.x + i + half + 1);
+    }
+
+    for (int j = 0; j < r.height; ++j) {
+        const int y = r.y + j;
+        const int y0 = std::max(r.y, y - half);
+        const int y1 = std::min(r.y + r.height, y + half + 1);
+        const int* top = sum_.ptr<int>(y0);
+        const int* bot = sum_.ptr<int>(y1);
+        const unsigned char* src = smooth_.ptr<unsigned char>(y) + r.x;
+        unsigned char* out = dst.ptr<unsigned char>(j);
+        const int h = y1 - y0;
+
+        for (int i = 0; i < r.width; ++i) {
+            const int a = x0[i], b = x1[i];
+            const int s = bot[b] - top[b] - bot[a] + top[a];
+            const int area = h * (b - a);
+            // src + C <= round(s / area), without the division.
+            out[i] = (2 * (src[i] + idelta) * area <= 2 * s + area) ? 255 : 0;
+        }
+    }
+}
+
+}
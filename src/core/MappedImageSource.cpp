@@ -0,0 +1,233 @@
+#include "core/MappedImageSource.hpp"
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept {
+    *this = std::move(o);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this == &o) return *this;
+    close();
+    data_ = o.data_;
+    size_ = o.size_;
+    writable_ = o.writable_;
+#ifdef _WIN32
+    file_ = o.file_;
+    mapping_ = o.mapping_;
+    o.file_ = nullptr;
+    o.mapping_ = nullptr;
+#else
+    fd_ = o.fd_;
+    o.fd_ = -1;
+#endif
+    o.data_ = nullptr;
+    o.size_ = 0;
+    o.writable_ = false;
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz) || sz.QuadPart == 0) {
+        CloseHandle(f);
+        return false;
+    }
+
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) {
+        CloseHandle(f);
+        return false;
+    }
+
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+
+    file_ = f;
+    mapping_ = m;
+    data_ = static_cast<const unsigned char*>(p);
+    size_ = static_cast<size_t>(sz.QuadPart);
+    return true;
+}
+
+bool MappedFile::openReadWrite(const std::string& path, size_t size) {
+    close();
+    if (size == 0) return false;
+
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz;
+    sz.QuadPart = static_cast<LONGLONG>(size);
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READWRITE, sz.HighPart, sz.LowPart, nullptr);
+    if (!m) {
+        CloseHandle(f);
+        return false;
+    }
+
+    void* p = MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, size);
+    if (!p) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+
+    file_ = f;
+    mapping_ = m;
+    data_ = static_cast<const unsigned char*>(p);
+    size_ = size;
+    writable_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_) CloseHandle(static_cast<HANDLE>(file_));
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
+
+void MappedFile::adviseWillNeed() const {
+    // FILE_FLAG_SEQUENTIAL_SCAN already enables aggressive readahead.
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    fd_ = fd;
+    data_ = static_cast<const unsigned char*>(p);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+bool MappedFile::openReadWrite(const std::string& path, size_t size) {
+    close();
+    if (size == 0) return false;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (static_cast<size_t>(st.st_size) != size && ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    data_ = static_cast<const unsigned char*>(p);
+    size_ = size;
+    writable_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+    writable_ = false;
+}
+
+void MappedFile::adviseWillNeed() const {
+    if (!data_) return;
+    madvise(const_cast<unsigned char*>(data_), size_, MADV_WILLNEED);
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd_, 0, static_cast<off_t>(size_), POSIX_FADV_WILLNEED);
+#endif
+}
+
+#endif
+
+MappedImageSource::MappedImageSource(std::vector<std::string> paths, int prefetch)
+    : paths_(std::move(paths)), prefetch_(std::max(0, prefetch)), end_(paths_.size()) {}
+
+void MappedImageSource::seek(size_t begin, size_t end) {
+    window_.clear();
+    end_ = std::min(end, paths_.size());
+    cursor_ = std::min(begin, end_);
+    mappedUpTo_ = cursor_;
+}
+
+void MappedImageSource::fillWindow() {
+    size_t limit = std::min(end_, cursor_ + 1 + static_cast<size_t>(prefetch_));
+    while (mappedUpTo_ < limit) {
+        MappedFile f;
+        if (f.open(paths_[mappedUpTo_])) f.adviseWillNeed();
+        window_.push_back(std::move(f));
+        mappedUpTo_++;
+    }
+}
+
+bool MappedImageSource::next(Item& out) {
+    if (cursor_ >= end_) return false;
+
+    fillWindow();
+
+    out.index = cursor_;
+    out.path = paths_[cursor_];
+    out.file = std::move(window_.front());
+    window_.pop_front();
+    cursor_++;
+    return true;
+}
+
+}
@@ -1,37 +1,155 @@
 #include "core/PerspectiveCorrector.hpp"
+#include <algorithm>
+#include <cmath>
 using namespace cv;
 
 namespace core {
 
+namespace {
+
+// Page enhancement in its three stages; warpRegions() runs them separately
+// so a patch gets exactly the page-level result inside the kept area.
+const cv::Size kClaheTiles(8, 8);
+const int kBilateralD = 9;
+const int kSharpenK = 5;
+
+cv::Mat denoise(const cv::Mat& gray) {
+    cv::Mat denoised;
+    cv::bilateralFilter(gray, denoised, kBilateralD, 100, 100);
+    return denoised;
+}
+
+cv::Mat equalize(const cv::Mat& denoised, cv::Size tiles) {
+    cv::Ptr<CLAHE> clahe = cv::createCLAHE();
+    clahe->setClipLimit(2.0);
+    clahe->setTilesGridSize(tiles);
+    cv::Mat enhanced;
+    clahe->apply(denoised, enhanced);
+    return enhanced;
+}
+
+cv::Mat sharpen(const cv::Mat& enhanced) {
+    cv::Mat blurred;
+    cv::GaussianBlur(enhanced, blurred, cv::Size(kSharpenK, kSharpenK), 1.0);
+    cv::Mat sharpened;
+    cv::addWeighted(enhanced, 1.2, blurred, -0.2, 0, sharpened);
+    return sharpened;
+}
+
+cv::Mat enhance(const cv::Mat& warpedGray) {
+    return sharpen(equalize(denoise(warpedGray), kClaheTiles));
+}
+
+// Readers threshold each region with windows up to this radius (the largest
+// identity block is 31), so that much real page is kept around every patch.
+const int kThresholdRadius = 15;
+
+cv::Rect grow(const cv::Rect& r, int by) {
+    return cv::Rect(r.x - by, r.y - by, r.width + 2 * by, r.height + 2 * by);
+}
+
+// Page -> source coordinates for every output pixel, in the fixed-point
+// form cv::remap consumes fastest.
+void buildRemapMaps(const cv::Mat& H, cv::Size size, cv::Mat& map1, cv::Mat& map2) {
+    cv::Mat Hinv = H.inv();
+    const double* h = Hinv.ptr<double>(0);
+
+    cv::Mat mapX(size, CV_32FC1), mapY(size, CV_32FC1);
+    for (int y = 0; y < size.height; ++y) {
+        float* mx = mapX.ptr<float>(y);
+        float* my = mapY.ptr<float>(y);
+        double bx = h[1] * y + h[2];
+        double by = h[4] * y + h[5];
+        double bw = h[7] * y + h[8];
+        for (int x = 0; x < size.width; ++x) {
+            double w = h[6] * x + bw;
+            w = (w != 0.0) ? 1.0 / w : 0.0;
+            mx[x] = static_cast<float>((h[0] * x + bx) * w);
+            my[x] = static_cast<float>((h[3] * x + by) * w);
+        }
+    }
+    cv::convertMaps(mapX, mapY, map1, map2, CV_16SC2);
+}
+
+}
+
 PerspectiveCorrector::PerspectiveCorrector(int outW, int outH)
     : outW_(outW), outH_(outH), finder_(outW, outH) {}
 
+void PerspectiveCorrector::setRemapCache(bool enabled, float tolerancePx) {
+    std::lock_guard<std::mutex> lk(remapMtx_);
+    remapEnabled_ = enabled;
+    remapTolerance_ = std::max(0.0f, tolerancePx);
+    remap_.reset();
+}
+
+uint64_t PerspectiveCorrector::remapRebuilds() const {
+    std::lock_guard<std::mutex> lk(remapMtx_);
+    return remapRebuilds_;
+}
+
+std::shared_ptr<const PerspectiveCorrector::RemapMaps>
+PerspectiveCorrector::remapFor(const CornerResult& C) const {
+    {
+        std::lock_guard<std::mutex> lk(remapMtx_);
+        if (remap_) {
+            bool stable = true;
+            for (int i = 0; i < 4 && stable; ++i) {
+                cv::Point2f d = C.markers_orig[i] - remap_->corners[i];
+                stable = std::abs(d.x) <= remapTolerance_ && std::abs(d.y) <= remapTolerance_;
+            }
+            if (stable) return remap_;
+        }
+    }
+
+    auto maps = std::make_shared<RemapMaps>();
+    maps->corners = C.markers_orig;
+    buildRemapMaps(C.H, cv::Size(outW_, outH_), maps->map1, maps->map2);
+
+    std::lock_guard<std::mutex> lk(remapMtx_);
+    remap_ = maps;
+    remapRebuilds_++;
+    return maps;
+}
+
 WarpResult PerspectiveCorrector::findAndWarp(const cv::Mat& bgr, bool wantDebug) const {
+    if (bgr.empty()) return WarpResult();
+    return warp(bgr, finder_.processFrame(bgr, wantDebug, !remapEnabled_), wantDebug);
+}
+
+WarpResult PerspectiveCorrector::findAndWarpRegions(const cv::Mat& bgr,
+                                                    const std::vector<cv::Rect>& rects,
+                                                    bool wantDebug) const {
+    if (bgr.empty()) return WarpResult();
+    return warpRegions(bgr, finder_.processFrame(bgr, wantDebug, false), rects, wantDebug);
+}
+
+WarpResult PerspectiveCorrector::warp(const cv::Mat& bgr, const CornerResult& C, bool wantDebug) const {
     WarpResult R;
     if (bgr.empty()) return R;
 
-    CornerResult C = finder_.processFrame(bgr, wantDebug);
     if (wantDebug) R.debug = C.debug_bgr.empty() ? bgr.clone() : C.debug_bgr;
+    R.quality = C.quality;
+    R.orientation = C.orientation;
 
-    if (!C.paper_ok) {
+    if (!C.paper_ok || (C.warped_gray.empty() && C.H.empty())) {
         R.ok = false;
         return R;
     }
 
-    cv::Mat warpedGray = C.warped_gray.clone();
-    cv::Mat denoised;
-    cv::bilateralFilter(warpedGray, denoised, 9, 100, 100);
-
-    cv::Ptr<CLAHE> clahe = cv::createCLAHE();
-    clahe->setClipLimit(2.0);
-    clahe->setTilesGridSize(cv::Size(8, 8));
-    cv::Mat enhanced;
-    clahe->apply(denoised, enhanced);
+    cv::Mat pageGray = C.warped_gray;
+    if (pageGray.empty()) {
+        if (remapEnabled_) {
+            auto maps = remapFor(C);
+            cv::remap(C.source_gray, pageGray, maps->map1, maps->map2,
+                      INTER_LINEAR, BORDER_REPLICATE);
+        } else {
+            cv::warpPerspective(C.source_gray, pageGray, C.H, cv::Size(outW_, outH_),
+                                INTER_LINEAR, BORDER_REPLICATE);
+        }
+    }
 
-    cv::Mat blurred;
-    cv::GaussianBlur(enhanced, blurred, cv::Size(5, 5), 1.0);
-    cv::Mat sharpened;
-    cv::addWeighted(enhanced, 1.2, blurred, -0.2, 0, sharpened);
+    cv::Mat sharpened = enhance(pageGray);
 
     cv::Mat warpedBgr;
     cv::cvtColor(sharpened, warpedBgr, cv::COLOR_GRAY2BGR);
@@ -43,4 +161,77 @@ WarpResult PerspectiveCorrector::findAndWarp(const cv::Mat& bgr, bool wantDebug)
     return R;
 }
 
+WarpResult PerspectiveCorrector::warpRegions(const cv::Mat& bgr, const CornerResult& C,
+                                             const std::vector<cv::Rect>& rects,
+                                             bool wantDebug) const {
+    WarpResult R;
+    if (bgr.empty()) return R;
+
+    if (wantDebug) R.debug = C.debug_bgr.empty() ? bgr.clone() : C.debug_bgr;
+    R.quality = C.quality;
+    R.orientation = C.orientation;
+
+    if (!C.paper_ok || C.H.empty()) {
+        R.ok = false;
+        return R;
+    }
+
+    const cv::Mat& gray = C.source_gray;
+    auto maps = remapEnabled_ ? remapFor(C) : nullptr;
+
+    const cv::Rect page(0, 0, outW_, outH_);
+    cv::Mat out(outH_, outW_, CV_8UC1, cv::Scalar(0));
+
+    // CLAHE interpolates every pixel from the nearest tile centres, so a patch
+    // snapped to the page's tile grid, one tile beyond the kept area, sees the
+    // same histograms as the full page; the bilateral filter additionally
+    // needs its radius of real pixels around those tiles.
+    const cv::Size tile(std::max(1, outW_ / kClaheTiles.width),
+                        std::max(1, outH_ / kClaheTiles.height));
+    const cv::Rect tiledPage(0, 0, tile.width * kClaheTiles.width,
+                             tile.height * kClaheTiles.height);
+    const int denoisePad = kBilateralD / 2;
+
+    for (const cv::Rect& rect : rects) {
+        cv::Rect target = rect & page;
+        if (target.area() <= 0) continue;
+        cv::Rect keep = grow(target, kThresholdRadius) & page;
+
+        int tx0 = std::max(0, keep.x / tile.width - 1);
+        int ty0 = std::max(0, keep.y / tile.height - 1);
+        int tx1 = std::min(kClaheTiles.width, (keep.br().x - 1) / tile.width + 2);
+        int ty1 = std::min(kClaheTiles.height, (keep.br().y - 1) / tile.height + 2);
+        cv::Rect tiled = cv::Rect(tx0 * tile.width, ty0 * tile.height,
+                                  (tx1 - tx0) * tile.width, (ty1 - ty0) * tile.height) & tiledPage;
+        if (!(keep & tiled).area()) continue;
+        keep &= tiled;
+
+        cv::Rect padded = grow(tiled, denoisePad) & page;
+
+        cv::Mat patch;
+        if (maps) {
+            cv::remap(gray, patch, maps->map1(padded), maps->map2(padded),
+                      INTER_LINEAR, BORDER_REPLICATE);
+        } else {
+            cv::Mat shift = (cv::Mat_<double>(3, 3) << 1, 0, -padded.x,
+                                                       0, 1, -padded.y,
+                                                       0, 0, 1);
+            cv::warpPerspective(gray, patch, shift * C.H, padded.size(),
+                                INTER_LINEAR, BORDER_REPLICATE);
+        }
+
+        cv::Rect inTiled(tiled.x - padded.x, tiled.y - padded.y, tiled.width, tiled.height);
+        cv::Mat enhanced = sharpen(equalize(denoise(patch)(inTiled),
+                                            cv::Size(tx1 - tx0, ty1 - ty0)));
+        cv::Rect inner(keep.x - tiled.x, keep.y - tiled.y, keep.width, keep.height);
+        enhanced(inner).copyTo(out(keep));
+    }
+
+    R.warped = out;
+    R.corners = C.markers_orig;
+    R.ok = true;
+
+    return R;
+}
+
 }
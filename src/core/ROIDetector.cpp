@@ -3,18 +3,17 @@
 #include <iostream>
 #include <algorithm>
 #include <set>
-#include <sstream>
 
 using namespace cv;
 using namespace std;
 
 namespace {
 
-cv::Rect rectPct(const cv::Mat& img, float x, float y, float w, float h) {
-    int X = static_cast<int>(x * img.cols);
-    int Y = static_cast<int>(y * img.rows);
-    int W = static_cast<int>(w * img.cols);
-    int H = static_cast<int>(h * img.rows);
+cv::Rect rectPct(const cv::Size& img, float x, float y, float w, float h) {
+    int X = static_cast<int>(x * img.width);
+    int Y = static_cast<int>(y * img.height);
+    int W = static_cast<int>(w * img.width);
+    int H = static_cast<int>(h * img.height);
     return cv::Rect(X, Y, W, H);
 }
 
@@ -182,6 +181,167 @@ static std::string detectSingleColumn(const cv::Mat& roiGray, int rows, double f
     return std::to_string(bestIdx);
 }
 
+const std::string kDigits = "0123456789";
+const std::string kTrLetters = "ABCCDEFGGHIIJKLMNOOPRSSTUUVYZ";
+const std::string kBooklets = "ABCD";
+
+// Binarisation and decoding for the per-column identity grids. threshold is
+// only the fallback for sheets the calibration cannot split.
+struct IdentityReadParams {
+    int blur;
+    int block;
+    double C;
+    double globalThr;
+    bool erode;
+    double threshold;
+    const std::string* alphabet;
+    char emptyChar;
+};
+
+const IdentityReadParams kTcParams        = {5, 21, 15, 160, false, 0.30, &kDigits, '-'};
+const IdentityReadParams kStudentNoParams = {7, 25, 20, 180, true,  0.10, &kDigits, '-'};
+const IdentityReadParams kNameParams      = {5, 31, 25, 160, false, 0.40, &kTrLetters, ' '};
+const IdentityReadParams kBookletParams   = {5, 21, 15, 160, false, 0.30, &kBooklets, '-'};
+
+const IdentityReadParams* identityParamsFor(const std::string& region) {
+    if (region == "tc_kimlik") return &kTcParams;
+    if (region == "ogrenci_no") return &kStudentNoParams;
+    if (region == "adi_soyadi") return &kNameParams;
+    if (region == "kitapcik") return &kBookletParams;
+    return nullptr;
+}
+
+// Answer-grid fallback: the fill ratio the old fixed 60% confidence cut used.
+const double kAnswerMarkThreshold = 0.60;
+// Calibrated cut-offs are only trusted when marked and unmarked cells differ
+// by at least this much in mean fill.
+const double kMinClassSeparation = 0.25;
+
+// With a prepared local-mean table the page's shared smoothing and box-mean
+// threshold are used (p.blur is then ignored); otherwise the ROI is blurred
+// and Gaussian-thresholded on its own.
+static cv::Mat binarizeIdentity(const cv::Mat& roiGray, const IdentityReadParams& p,
+                                const core::LocalMeanThreshold* localMean, const cv::Rect& roi) {
+    cv::Mat workingImg;
+    cv::Mat adaptiveBin;
+    if (localMean) {
+        workingImg = localMean->smoothed()(roi);
+        localMean->binarizeInv(roi, p.block, p.C, adaptiveBin);
+    } else {
+        cv::GaussianBlur(roiGray, workingImg, cv::Size(p.blur, p.blur), 0);
+        cv::adaptiveThreshold(workingImg, adaptiveBin, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
+                              cv::THRESH_BINARY_INV, p.block, p.C);
+    }
+
+    cv::Mat globalBin;
+    cv::threshold(workingImg, globalBin, p.globalThr, 255, cv::THRESH_BINARY_INV);
+
+    cv::Mat finalBin;
+    cv::bitwise_and(adaptiveBin, globalBin, finalBin);
+
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
+    cv::morphologyEx(finalBin, finalBin, cv::MORPH_OPEN, kernel);
+
+    if (p.erode) {
+        cv::Mat kernelErode = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
+        cv::erode(finalBin, finalBin, kernelErode, cv::Point(-1, -1), 1);
+    }
+    return finalBin;
+}
+
+// Inner-cell fill ratios, row-major. Debug circles and percentages are drawn
+// into dbg, the region's own view of the debug image (may be empty).
+static void measureIdentityCells(const cv::Mat& bin, int rows, int cols,
+                                 std::vector<float>& ratios) {
+    ratios.assign(static_cast<size_t>(rows) * cols, 0.0f);
+
+    int cellW = bin.cols / cols;
+    int cellH = bin.rows / rows;
+    int marginX = static_cast<int>(cellW * 0.30);
+    int marginY = static_cast<int>(cellH * 0.30);
+
+    for (int c = 0; c < cols; ++c) {
+        for (int r = 0; r < rows; ++r) {
+            cv::Rect cell(c * cellW + marginX, r * cellH + marginY,
+                          cellW - 2 * marginX, cellH - 2 * marginY);
+            cell &= cv::Rect(0, 0, bin.cols, bin.rows);
+            if (cell.width <= 0 || cell.height <= 0) continue;
+
+            double ratio = (double)cv::countNonZero(bin(cell)) / (cell.width * cell.height);
+            ratios[r * cols + c] = static_cast<float>(ratio);
+        }
+    }
+}
+
+// Cell outlines and fill percentages of an identity grid, into its ROI of
+// the debug image.
+static void drawIdentityCells(cv::Mat dbg, const std::vector<float>& ratios, int rows, int cols) {
+    if (static_cast<int>(ratios.size()) != rows * cols) return;
+    int cellW = dbg.cols / cols;
+    int cellH = dbg.rows / rows;
+
+    for (int c = 0; c < cols; ++c) {
+        for (int r = 0; r < rows; ++r) {
+            int centerX = (c * cellW) + (cellW / 2);
+            int centerY = (r * cellH) + (cellH / 2);
+            int radius = std::min(cellW, cellH) * 0.35;
+
+            cv::circle(dbg, cv::Point(centerX, centerY), radius,
+                       cv::Scalar(100, 100, 100), 1, cv::LINE_AA);
+
+            double ratio = ratios[r * cols + c];
+            if (ratio > 0.05) {
+                cv::putText(dbg, std::to_string((int)(ratio * 100)),
+                            cv::Point(centerX - 10, centerY + 5),
+                            cv::FONT_HERSHEY_DUPLEX, 0.40, cv::Scalar(0, 255, 0), 1);
+            }
+        }
+    }
+}
+
+// One mark per column; row r maps to alphabet[r]. The chosen cells are
+// outlined in dbg (may be empty).
+static std::string decodeIdentityColumns(const std::vector<float>& ratios, int rows, int cols,
+                                         double threshold, const IdentityReadParams& p, cv::Mat dbg) {
+    std::string result;
+    result.reserve(cols);
+
+    const std::string& alphabet = *p.alphabet;
+    int cellW = dbg.cols / cols;
+    int cellH = dbg.rows / rows;
+
+    for (int c = 0; c < cols; ++c) {
+        double bestVal = 0.0;
+        int bestRow = -1;
+        for (int r = 0; r < rows; ++r) {
+            if (ratios[r * cols + c] > bestVal) {
+                bestVal = ratios[r * cols + c];
+                bestRow = r;
+            }
+        }
+
+        char detectedChar = p.emptyChar;
+        if (bestVal >= threshold && bestRow != -1 && bestRow < (int)alphabet.size()) {
+            detectedChar = alphabet[bestRow];
+
+            if (!dbg.empty()) {
+                cv::Rect finalCell(c * cellW, bestRow * cellH, cellW, cellH);
+                cv::rectangle(dbg, finalCell, cv::Scalar(0, 255, 0), 2);
+                cv::putText(dbg, std::string(1, detectedChar),
+                            cv::Point(finalCell.x + 5, finalCell.y + finalCell.height - 5),
+                            cv::FONT_HERSHEY_SIMPLEX, 0.50, cv::Scalar(0, 255, 0), 2);
+            }
+        }
+        result += detectedChar;
+    }
+
+    if (p.emptyChar == ' ') {
+        size_t lastChar = result.find_last_not_of(' ');
+        result = (lastChar != std::string::npos) ? result.substr(0, lastChar + 1) : std::string();
+    }
+    return result;
+}
+
 } 
 
 ROIDetector::ROIDetector()
@@ -216,11 +376,38 @@ ROIDetector::ROIDetector()
     regions_.push_back({ "fen",       {0.757f, 0.640f, 0.125f, 0.345f}, 20, 4, GRID });
 }
 
+void ROIDetector::setBookletRegion(const float rectPct[4]) {
+    RegionDef booklet = { "kitapcik", {rectPct[0], rectPct[1], rectPct[2], rectPct[3]}, 4, 1, GRID };
+    for (auto& reg : regions_) {
+        if (reg.name == booklet.name) {
+            reg = booklet;
+            return;
+        }
+    }
+    // Appended so the other regions keep their history slots and cell offsets.
+    regions_.push_back(booklet);
+}
+
 void ROIDetector::setFillThreshold(double threshold) {
     fillThreshold_ = threshold;
     bubbleDetector_.setFillThreshold(threshold);
 }
 
+ROIDetector::~ROIDetector() = default;
+
+void ROIDetector::setRegionThreads(int n) {
+    n = std::max(1, n);
+    if (n == getRegionThreads()) return;
+
+    pool_.reset();
+    if (n > 1) pool_ = std::make_unique<core::TaskPool>(n);
+}
+
+void ROIDetector::setThresholdMethod(ThresholdMethod method) {
+    thresholdMethod_ = method;
+    if (method != BoxMean) localMean_.clear();
+}
+
 void ROIDetector::setDebugMode(bool enabled) {
     debugMode_ = enabled;
 }
@@ -230,403 +417,297 @@ cv::Mat ROIDetector::getLastDebugVisualization() const {
     return lastDebugVis_.clone();
 }
 
-bool ROIDetector::isSubjectRegion(const std::string& name) const {
-    static const std::set<std::string> subjects = {
-        "turkce", "sosyal", "din", "ingilizce", "matematik", "fen"
+uint64_t ROIDetector::configFingerprint() const {
+    // FNV-1a over the region table and thresholds.
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const void* p, size_t n) {
+        const unsigned char* b = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= b[i];
+            h *= 1099511628211ull;
+        }
     };
-    return subjects.find(name) != subjects.end();
+
+    for (const auto& reg : regions_) {
+        mix(reg.name.data(), reg.name.size());
+        mix(reg.rectPct, sizeof(reg.rectPct));
+        mix(&reg.rows, sizeof(reg.rows));
+        mix(&reg.cols, sizeof(reg.cols));
+        mix(&reg.type, sizeof(reg.type));
+    }
+    mix(&fillThreshold_, sizeof(fillThreshold_));
+    mix(&thresholdMethod_, sizeof(thresholdMethod_));
+    mix(&autoCalibration_, sizeof(autoCalibration_));
+    mix(&gridAlignment_, sizeof(gridAlignment_));
+    return h;
 }
 
-std::string ROIDetector::bubblesToAnswerString(const std::vector<BubbleResult>& results) const {
-    std::ostringstream oss;
-    
-    const double CONFIDENCE_THRESHOLD = 60.0; 
-
-    for (size_t i = 0; i < results.size(); ++i) {
-        char mark = '-'; 
-        const auto& br = results[i];
-
-        if (!br.isValid) {
-            mark = 'X'; 
-        } 
-        else {
-            if (br.confidence < CONFIDENCE_THRESHOLD) {
-                mark = '-'; 
-            }
-            
-            else if (br.secondConfidence > CONFIDENCE_THRESHOLD) {
-                 mark = '-'; 
-            }
+void ROIDetector::setTemporalSmoothing(bool enabled, int historySize) {
+    bubbleDetector_.setTemporalSmoothing(enabled, historySize);
+}
 
-            else if (!br.markedAnswer.empty()) {
-                mark = br.markedAnswer[0];
-            }
-        }
+void ROIDetector::resetTemporalHistory() {
+    bubbleDetector_.resetHistory();
+}
 
-        if (i > 0) oss << ",";
-        oss << mark;
+bool ROIDetector::isReadStable() const {
+    if (!bubbleDetector_.isTemporalSmoothingEnabled()) return false;
+
+    bool any = false;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+        if (regions_[i].type != GRID || !isSubjectRegion(regions_[i].name)) continue;
+        if (!bubbleDetector_.isHistoryStable(static_cast<int>(i))) return false;
+        any = true;
     }
-    return oss.str();
+    return any;
 }
-std::map<std::string, std::string>
-ROIDetector::process(const cv::Mat& warped, cv::Mat& debugOut) {
-    CV_Assert(!warped.empty());
 
-    cv::Mat gray;
-    if (warped.channels() == 3)
-        cv::cvtColor(warped, gray, cv::COLOR_BGR2GRAY);
-    else
-        gray = warped.clone();
+bool ROIDetector::isSubjectRegion(const std::string& name) const {
+    static const std::set<std::string> subjects = {
+        "turkce", "sosyal", "din", "ingilizce", "matematik", "fen"
+    };
+    return subjects.find(name) != subjects.end();
+}
 
-    if (warped.channels() == 3)
-        lastDebugVis_ = warped.clone();
-    else
-        cv::cvtColor(warped, lastDebugVis_, cv::COLOR_GRAY2BGR);
+uint8_t ROIDetector::bubbleToCode(const BubbleResult& br, double markThreshold) const {
+    const double markPct = markThreshold * 100.0;
 
-    std::map<std::string, std::string> out;
+    // isValid is false only when no cell in the row has any fill: a clean blank.
+    if (!br.isValid) return AnswerVector::Blank;
+    if (br.markedAnswer.empty()) return AnswerVector::Uncertain;
+    if (br.confidence < markPct) return AnswerVector::Blank; 
+    if (br.secondConfidence >= markPct) return AnswerVector::Multi; 
+    return AnswerVector::fromChar(br.markedAnswer[0]);
+}
 
-    double idThr = std::clamp(fillThreshold_ * 1.2, 0.25, 0.45);
+AnswerVector ROIDetector::bubblesToAnswers(const std::vector<BubbleResult>& results,
+                                           double markThreshold) const {
+    AnswerVector out;
+    for (const auto& br : results) out.push(bubbleToCode(br, markThreshold));
+    return out;
+}
 
+std::vector<cv::Rect> ROIDetector::regionRects(const cv::Size& page) const {
+    std::vector<cv::Rect> rects;
+    rects.reserve(regions_.size());
     for (const auto& reg : regions_) {
-        cv::Rect roi = rectPct(gray, reg.rectPct[0], reg.rectPct[1],
-                               reg.rectPct[2], reg.rectPct[3]);
-
-        if (reg.type == GRID) {
-            int dx = std::max(1, static_cast<int>(roi.width * 0.02));
-            int dy = std::max(1, static_cast<int>(roi.height * 0.02));
-            roi = cv::Rect(roi.x + dx, roi.y + dy,
-                           std::max(1, roi.width - 2 * dx),
-                           std::max(1, roi.height - 2 * dy));
-        }
-
-        if (isSubjectRegion(reg.name)) {
+        cv::Rect r = regionRect(reg, page);
+        if (gridAlignment_ && reg.type == GRID)
+            r = gridAligner_.searchArea(r, reg.rows, reg.cols, page);
+        if (r.width > 0 && r.height > 0) rects.push_back(r);
+    }
+    return rects;
+}
 
-            double questionOffsetRatio = 0.19; 
-            double widthScaleFactor = 0.95;    
+cv::Rect ROIDetector::regionRect(const RegionDef& reg, const cv::Size& page) const {
+    cv::Rect roi = rectPct(page, reg.rectPct[0], reg.rectPct[1],
+                           reg.rectPct[2], reg.rectPct[3]);
 
-            int originalW = roi.width;
-            
-            int offsetX = static_cast<int>(originalW * questionOffsetRatio);
-            
-            int targetTotalW = static_cast<int>(originalW * widthScaleFactor);
-            int newWidth = std::max(1, targetTotalW - offsetX);
+    if (reg.type == GRID) {
+        int dx = std::max(1, static_cast<int>(roi.width * 0.02));
+        int dy = std::max(1, static_cast<int>(roi.height * 0.02));
+        roi = cv::Rect(roi.x + dx, roi.y + dy,
+                       std::max(1, roi.width - 2 * dx),
+                       std::max(1, roi.height - 2 * dy));
+    }
 
-            roi.x += offsetX;
-            roi.width = newWidth;
-        }
+    if (isSubjectRegion(reg.name)) {
 
-        roi &= cv::Rect(0, 0, gray.cols, gray.rows);
-        if (roi.width <= 0 || roi.height <= 0) continue;
+        double questionOffsetRatio = 0.19; 
+        double widthScaleFactor = 0.95;    
 
-        cv::Mat sub = gray(roi).clone();
-        std::string val;
+        int originalW = roi.width;
+        
+        int offsetX = static_cast<int>(originalW * questionOffsetRatio);
+        
+        int targetTotalW = static_cast<int>(originalW * widthScaleFactor);
+        int newWidth = std::max(1, targetTotalW - offsetX);
 
-        if (reg.type == GRID && isSubjectRegion(reg.name)) {
-            
-            auto bubbles = bubbleDetector_.detectBubblesWithContours(sub, reg.rows, reg.cols, 1, 'A');
-            val = bubblesToAnswerString(bubbles);
+        roi.x += offsetX;
+        roi.width = newWidth;
+    }
 
-            if (debugMode_) {
-                bubbleDetector_.drawBubbleDebug(lastDebugVis_, roi, bubbles, reg.rows, reg.cols, reg.name);
-            }
-        }
-        else if (reg.name == "tc_kimlik") { 
-            
-            std::string resultString = "";
-            int rows = reg.rows; 
-            int cols = reg.cols; 
-            
-            int cellW = sub.cols / cols;
-            int cellH = sub.rows / rows;
-
-            cv::Mat workingImg = sub.clone();
-
-            cv::GaussianBlur(workingImg, workingImg, cv::Size(5, 5), 0);
-            
-            cv::Mat adaptiveBin;
-            cv::adaptiveThreshold(workingImg, adaptiveBin, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, 21, 15); 
-
-            cv::Mat globalBin;
-            cv::threshold(workingImg, globalBin, 160, 255, cv::THRESH_BINARY_INV);
-
-            cv::Mat finalBin;
-            cv::bitwise_and(adaptiveBin, globalBin, finalBin);
-            
-            cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-            cv::morphologyEx(finalBin, finalBin, cv::MORPH_OPEN, kernel);
-
-            for (int c = 0; c < cols; ++c) {
-                
-                double bestVal = 0.0;
-                int bestRow = -1;
-
-                for (int r = 0; r < rows; ++r) {
-                    
-                    int marginX = static_cast<int>(cellW * 0.30);
-                    int marginY = static_cast<int>(cellH * 0.30);
-                    
-                    cv::Rect cell(c * cellW + marginX, r * cellH + marginY, 
-                                  cellW - 2*marginX, cellH - 2*marginY);
-                    
-                    cell &= cv::Rect(0, 0, finalBin.cols, finalBin.rows);
-                    if (cell.width <= 0 || cell.height <= 0) continue;
-
-                    cv::Mat binCell = finalBin(cell);
-                    
-                    double ratio = (double)cv::countNonZero(binCell) / (cell.width * cell.height);
-
-                    if (ratio > bestVal) {
-                        bestVal = ratio;
-                        bestRow = r;
-                    }
+    return roi & cv::Rect(0, 0, page.width, page.height);
+}
 
-                    if (debugMode_) {
-                        int centerX = roi.x + (c * cellW) + (cellW / 2);
-                        int centerY = roi.y + (r * cellH) + (cellH / 2);
-                        int radius = std::min(cellW, cellH) * 0.35;
+cv::Rect ROIDetector::alignedRect(const RegionDef& reg, const cv::Mat& gray) const {
+    cv::Rect roi = regionRect(reg, gray.size());
+    if (!gridAlignment_ || reg.type != GRID || roi.width <= 0 || roi.height <= 0) return roi;
+    return gridAligner_.align(gray, roi, reg.rows, reg.cols);
+}
 
-                        cv::circle(lastDebugVis_, cv::Point(centerX, centerY), radius, 
-                                   cv::Scalar(100, 100, 100), 1, cv::LINE_AA);
+std::map<std::string, std::vector<ROIDetector::QuestionDetail>>
+ROIDetector::processWithDetails(
+    const cv::Mat& warped,
+    cv::Mat& debugOut,
+    const AnswerKey& answerKey,
+    SheetRead* readOut)
+{
+    SheetRead read = process(warped, debugOut);
+    const AnswerKey::CompiledKey& key = answerKey.compiled(AnswerKey::bookletFromFields(read.fields));
 
-                        if (ratio > 0.05) {
-                            std::string scoreTxt = std::to_string((int)(ratio * 100));
-                            cv::putText(lastDebugVis_, scoreTxt,
-                                       cv::Point(centerX - 10, centerY + 5), 
-                                       cv::FONT_HERSHEY_DUPLEX, 0.40, cv::Scalar(0, 255, 0), 1);
-                        }
-                    }
-                }
+    std::map<std::string, std::vector<QuestionDetail>> out;
+    size_t cellOffset = 0;
 
-                double THRESHOLD = 0.30; 
-                char detectedChar = '-'; 
-                
-                if (bestVal > THRESHOLD && bestRow != -1) {
-                    detectedChar = '0' + bestRow;
-
-                    if (debugMode_) {
-                        cv::Rect finalCell(roi.x + c * cellW, roi.y + bestRow * cellH, cellW, cellH);
-                        
-                        cv::rectangle(lastDebugVis_, finalCell, cv::Scalar(0, 255, 0), 2);
-                        
-                        std::string charTxt(1, detectedChar);
-                        cv::putText(lastDebugVis_, charTxt,
-                                   cv::Point(finalCell.x + 5, finalCell.y + finalCell.height - 5),
-                                   cv::FONT_HERSHEY_SIMPLEX, 0.50, cv::Scalar(0, 255, 0), 2);
+    for (const auto& reg : regions_) {
+        const size_t offset = cellOffset;
+        cellOffset += static_cast<size_t>(reg.rows) * reg.cols;
+
+        auto itRow = read.subjects.find(reg.name);
+        if (itRow == read.subjects.end()) continue;
+        const AnswerVector& row = itRow->second;
+
+        const int keyIdx = key.subjectIndex(reg.name);
+        const AnswerKey::CompiledKey::Subject* subject = keyIdx >= 0 ? &key.subjects[keyIdx] : nullptr;
+
+        std::vector<QuestionDetail>& details = out[reg.name];
+        details.reserve(row.size());
+
+        for (int i = 0; i < row.size(); ++i) {
+            QuestionDetail d;
+            d.questionNumber = i;
+            d.markedAnswer = AnswerVector::toChar(row[i]);
+            d.correctAnswer = '-';
+            d.isCorrect = false;
+
+            d.fillRatio = 0.0;
+            const size_t first = offset + static_cast<size_t>(i) * reg.cols;
+            for (int c = 0; c < reg.cols && first + c < read.cellFills.size(); ++c)
+                d.fillRatio = std::max(d.fillRatio, static_cast<double>(read.cellFills[first + c]));
+
+            if (subject && i < subject->count) {
+                const int q = subject->first + i;
+                for (int k = 0; k < 26; ++k) {
+                    if ((key.accept[q] >> k) & 1u) {
+                        d.correctAnswer = static_cast<char>('A' + k);
+                        break;
                     }
                 }
-                
-                resultString += detectedChar;
+                d.isCorrect = key.scores(q, row[i]);
             }
-            
-            val = resultString;
+            details.push_back(d);
         }
-        else if (reg.name == "ogrenci_no") { 
-            
-            std::string resultString = "";
-            int rows = reg.rows; 
-            int cols = reg.cols; 
-            
-            int cellW = sub.cols / cols;
-            int cellH = sub.rows / rows;
-
-            cv::Mat workingImg = sub.clone();
-
-            cv::GaussianBlur(workingImg, workingImg, cv::Size(7, 7), 0);
-            
-            cv::Mat adaptiveBin;
-            cv::adaptiveThreshold(workingImg, adaptiveBin, 255,
-                                  cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-                                  cv::THRESH_BINARY_INV,
-                                  25, 20); 
-
-            cv::Mat globalBin;
-            cv::threshold(workingImg, globalBin, 180, 255, cv::THRESH_BINARY_INV);
-
-            cv::Mat finalBin;
-            cv::bitwise_and(adaptiveBin, globalBin, finalBin);
-            
-            cv::Mat kernel_morph = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-            cv::morphologyEx(finalBin, finalBin, cv::MORPH_OPEN, kernel_morph);
-
-            cv::Mat kernel_erode = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
-            cv::erode(finalBin, finalBin, kernel_erode, cv::Point(-1, -1), 1);
-
-            for (int c = 0; c < cols; ++c) {
-                
-                double bestVal = 0.0;
-                int bestRow = -1;
-
-                for (int r = 0; r < rows; ++r) {
-                    
-                    int marginX = static_cast<int>(cellW * 0.30);
-                    int marginY = static_cast<int>(cellH * 0.30);
-                    
-                    cv::Rect cell(c * cellW + marginX, r * cellH + marginY, 
-                                  cellW - 2*marginX, cellH - 2*marginY);
-                    
-                    cell &= cv::Rect(0, 0, finalBin.cols, finalBin.rows);
-                    if (cell.width <= 0 || cell.height <= 0) continue;
-
-                    cv::Mat binCell = finalBin(cell);
-                    
-                    double ratio = (double)cv::countNonZero(binCell) / (cell.width * cell.height);
-
-                    if (ratio > bestVal) {
-                        bestVal = ratio;
-                        bestRow = r;
-                    }
+    }
 
-                    if (debugMode_) {
-                        int centerX = roi.x + (c * cellW) + (cellW / 2);
-                        int centerY = roi.y + (r * cellH) + (cellH / 2);
-                        int radius = std::min(cellW, cellH) * 0.35;
-
-                        cv::circle(lastDebugVis_, cv::Point(centerX, centerY), radius, 
-                                   cv::Scalar(100, 100, 100), 1, cv::LINE_AA);
-                        
-                        if (ratio > 0.05) {
-                            std::string scoreTxt = std::to_string((int)(ratio * 100));
-                            cv::putText(lastDebugVis_, scoreTxt,
-                                       cv::Point(centerX - 10, centerY + 5), 
-                                       cv::FONT_HERSHEY_DUPLEX, 0.40, cv::Scalar(0, 255, 0), 1);
-                        }
-                    }
-                }
+    if (readOut) *readOut = std::move(read);
+    return out;
+}
 
-                double THRESHOLD = 0.10; 
-                char detectedChar = '-'; 
-                
-                if (bestVal > THRESHOLD && bestRow != -1) {
-                    detectedChar = '0' + bestRow;
-
-                    if (debugMode_) {
-                        cv::Rect finalCell(roi.x + c * cellW, roi.y + bestRow * cellH, cellW, cellH);
-                        
-                        cv::rectangle(lastDebugVis_, finalCell, cv::Scalar(0, 255, 0), 2);
-                        
-                        std::string charTxt(1, detectedChar);
-                        cv::putText(lastDebugVis_, charTxt,
-                                   cv::Point(finalCell.x + 5, finalCell.y + finalCell.height - 5),
-                                   cv::FONT_HERSHEY_SIMPLEX, 0.50, cv::Scalar(0, 255, 0), 2);
-                    }
-                }
-                
-                resultString += detectedChar;
-            }
-            
-            val = resultString;
+void ROIDetector::readRegion(size_t regionIdx, const cv::Mat& gray, RegionOutput& out) {
+    const auto& reg = regions_[regionIdx];
+    out.roi = alignedRect(reg, gray);
+    if (out.roi.width <= 0 || out.roi.height <= 0) return;
+    out.valid = true;
+
+    cv::Mat sub = gray(out.roi);
+    const core::LocalMeanThreshold* localMean =
+        (thresholdMethod_ == BoxMean && localMean_.ready()) ? &localMean_ : nullptr;
+
+    if (reg.type == GRID && isSubjectRegion(reg.name)) {
+        std::vector<BubbleResult> bubbles;
+        if (localMean) {
+            thread_local cv::Mat bin;
+            localMean->binarizeInv(out.roi, 15, 3, bin);
+            out.bubbles = bubbleDetector_.detectBubblesSmoothedBinary(bin, reg.rows, reg.cols, 1, 'A',
+                                                                      static_cast<int>(regionIdx), &out.ratios);
+        } else {
+            out.bubbles = bubbleDetector_.detectBubblesSmoothed(sub, reg.rows, reg.cols, 1, 'A',
+                                                                static_cast<int>(regionIdx), &out.ratios);
         }
+    }
+    else if (const IdentityReadParams* p = identityParamsFor(reg.name)) {
+        measureIdentityCells(binarizeIdentity(sub, *p, localMean, out.roi), reg.rows, reg.cols,
+                             out.ratios);
+    }
+    else {
+        double idThr = std::clamp(fillThreshold_ * 1.2, 0.25, 0.45);
+        out.text = detectSingleColumn(sub, reg.rows, idThr);
+    }
+}
 
-        else if (reg.name == "adi_soyadi") {
-            
-            std::vector<std::string> TR_CHARS = {
-                "A","B","C","C","D","E","F","G","G","H","I","I","J","K","L","M",
-                "N","O","O","P","R","S","S","T","U","U","V","Y","Z"
-            };
-
-            std::string resultString = "";
-            int rows = reg.rows; 
-            int cols = reg.cols; 
-            
-            int cellW = sub.cols / cols;
-            int cellH = sub.rows / rows;
-
-            cv::Mat workingImg = sub.clone();
-            
-            cv::GaussianBlur(workingImg, workingImg, cv::Size(5, 5), 0);
-
-            cv::Mat adaptiveBin;
-            cv::adaptiveThreshold(workingImg, adaptiveBin, 255,
-                                  cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-                                  cv::THRESH_BINARY_INV,
-                                  31, 25);
-
-            cv::Mat globalBin;
-            cv::threshold(workingImg, globalBin, 160, 255, cv::THRESH_BINARY_INV);
-
-            cv::Mat finalBin;
-            cv::bitwise_and(adaptiveBin, globalBin, finalBin);
-
-            cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-            cv::morphologyEx(finalBin, finalBin, cv::MORPH_OPEN, kernel);
-
-            for (int c = 0; c < cols; ++c) {
-                
-                double bestVal = 0.0;
-                int bestRow = -1;
-
-                for (int r = 0; r < rows; ++r) {
-                    
-                    int marginX = static_cast<int>(cellW * 0.30);
-                    int marginY = static_cast<int>(cellH * 0.30);
-                    
-                    cv::Rect cell(c * cellW + marginX, r * cellH + marginY, 
-                                  cellW - 2*marginX, cellH - 2*marginY);
-                    
-                    cell &= cv::Rect(0, 0, finalBin.cols, finalBin.rows);
-                    if (cell.width <= 0 || cell.height <= 0) continue;
-
-                    cv::Mat binCell = finalBin(cell);
-                    
-                    double ratio = (double)cv::countNonZero(binCell) / (cell.width * cell.height);
-
-                    if (ratio > bestVal) {
-                        bestVal = ratio;
-                        bestRow = r;
-                    }
+ROIDetector::SheetRead
+ROIDetector::process(const cv::Mat& warped, cv::Mat& debugOut) {
+    CV_Assert(!warped.empty());
 
-                    if (debugMode_) {
-                        int centerX = roi.x + (c * cellW) + (cellW / 2);
-                        int centerY = roi.y + (r * cellH) + (cellH / 2);
-                        int radius = std::min(cellW, cellH) * 0.35;
-
-                        cv::circle(lastDebugVis_, cv::Point(centerX, centerY), radius, 
-                                   cv::Scalar(100, 100, 100), 1, cv::LINE_AA);
-                        
-                        if (ratio > 0.05) { 
-                            std::string scoreTxt = std::to_string((int)(ratio * 100));
-                            cv::putText(lastDebugVis_, scoreTxt,
-                                       cv::Point(centerX - 10, centerY + 5), 
-                                       cv::FONT_HERSHEY_DUPLEX, 0.40, cv::Scalar(0, 255, 0), 1);
-                        }
-                    }
-                }
+    cv::Mat gray;
+    if (warped.channels() == 3)
+        cv::cvtColor(warped, gray, cv::COLOR_BGR2GRAY);
+    else
+        gray = warped.clone();
 
-                double THRESHOLD = 0.40; 
-                std::string detectedChar = " "; 
-                
-                if (bestVal > THRESHOLD && bestRow != -1 && bestRow < (int)TR_CHARS.size()) {
-                    detectedChar = TR_CHARS[bestRow];
-
-                    if (debugMode_) {
-                        cv::Rect finalCell(roi.x + c * cellW, roi.y + bestRow * cellH, cellW, cellH);
-                        cv::rectangle(lastDebugVis_, finalCell, cv::Scalar(0, 255, 0), 2);
-                        cv::putText(lastDebugVis_, detectedChar,
-                                   cv::Point(finalCell.x + 5, finalCell.y + finalCell.height - 5),
-                                   cv::FONT_HERSHEY_SIMPLEX, 0.50, cv::Scalar(0, 255, 0), 2);
-                    }
-                }
-                
-                resultString += detectedChar;
-            }
-            
-            size_t lastChar = resultString.find_last_not_of(' ');
-            if (lastChar != std::string::npos) {
-                resultString = resultString.substr(0, lastChar + 1);
-            } else {
-                resultString = ""; 
-            }
+    if (warped.channels() == 3)
+        lastDebugVis_ = warped.clone();
+    else
+        cv::cvtColor(warped, lastDebugVis_, cv::COLOR_GRAY2BGR);
 
-            val = resultString;
-        }
-        else {
-            val = detectSingleColumn(sub, reg.rows, idThr);
+    // Regions write only into their own slot (aligned ROIs may overlap, so
+    // all debug drawing happens below, serially); history slots are created
+    // here so the reads can overlap.
+    std::vector<RegionOutput> slots(regions_.size());
+    const int n = static_cast<int>(regions_.size());
+
+    if (thresholdMethod_ == BoxMean) localMean_.prepare(gray);
+
+    if (pool_) {
+        for (int i = 0; i < n; ++i) bubbleDetector_.prepareHistory(i);
+        pool_->parallelFor(n, [&](int i) { readRegion(i, gray, slots[i]); });
+    } else {
+        for (int i = 0; i < n; ++i) readRegion(i, gray, slots[i]);
+    }
+
+    // Calibration: the answer grids share one marked/unmarked split, each
+    // identity grid (binarized and measured differently) gets its own.
+    SheetRead out;
+    out.answerThreshold = kAnswerMarkThreshold;
+    if (autoCalibration_) {
+        core::FillCalibrator answers;
+        for (size_t i = 0; i < slots.size(); ++i)
+            if (slots[i].valid && isSubjectRegion(regions_[i].name)) answers.add(slots[i].ratios);
+        core::FillSplit split = answers.split(kAnswerMarkThreshold, kMinClassSeparation);
+        if (split.ok) {
+            out.answerThreshold = split.threshold;
+            out.calibrated = true;
         }
+    }
 
-        out[reg.name] = val;
+    size_t cellCount = 0;
+    for (const auto& reg : regions_) cellCount += static_cast<size_t>(reg.rows) * reg.cols;
+    out.cellFills.assign(cellCount, 0.0f);
+    size_t cellOffset = 0;
+
+    for (size_t regionIdx = 0; regionIdx < regions_.size(); ++regionIdx) {
+        const auto& reg = regions_[regionIdx];
+        RegionOutput& slot = slots[regionIdx];
+        const size_t cells = static_cast<size_t>(reg.rows) * reg.cols;
+        if (slot.ratios.size() == cells)
+            std::copy(slot.ratios.begin(), slot.ratios.end(), out.cellFills.begin() + cellOffset);
+        cellOffset += cells;
+        if (!slot.valid) continue;
+
+        const IdentityReadParams* p = identityParamsFor(reg.name);
+        if (reg.type == GRID && isSubjectRegion(reg.name)) {
+            AnswerVector& answers = out.subjects[reg.name];
+            answers = bubblesToAnswers(slot.bubbles, out.answerThreshold);
+            bubbleDetector_.commitDecoded(static_cast<int>(regionIdx), answers);
+            if (debugMode_)
+                bubbleDetector_.drawBubbleDebug(lastDebugVis_, slot.roi, slot.bubbles, reg.rows, reg.cols, reg.name);
+        } else if (p) {
+            double thr = p->threshold;
+            if (autoCalibration_) {
+                core::FillCalibrator cal;
+                cal.add(slot.ratios);
+                core::FillSplit split = cal.split(p->threshold, std::min(kMinClassSeparation, p->threshold));
+                if (split.ok) thr = split.threshold;
+            }
+            cv::Mat dbg = debugMode_ ? lastDebugVis_(slot.roi) : cv::Mat();
+            if (debugMode_) drawIdentityCells(dbg, slot.ratios, reg.rows, reg.cols);
+            out.fields[reg.name] = decodeIdentityColumns(slot.ratios, reg.rows, reg.cols, thr, *p, dbg);
+        } else {
+            out.fields[reg.name] = slot.text;
+        }
 
-        cv::rectangle(lastDebugVis_, roi, cv::Scalar(0, 255, 0), 2);
-        cv::putText(lastDebugVis_, reg.name, roi.tl() + cv::Point(4, 16),
+        cv::rectangle(lastDebugVis_, slot.roi, cv::Scalar(0, 255, 0), 2);
+        cv::putText(lastDebugVis_, reg.name, slot.roi.tl() + cv::Point(4, 16),
                     cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 0, 255), 2);
     }
 
@@ -0,0 +1,283 @@
+#include "core/ResultCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+struct ResultCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint64_t tick;
+    unsigned char pad[32];
+};
+
+struct ResultCache::Record {
+    uint64_t key;       // 0 = empty slot
+    uint64_t lastUse;
+    uint32_t length;
+    unsigned char payload[ResultCache::kRecordSize - 20];
+};
+
+namespace {
+
+const char kMagic[8] = {'O', 'M', 'R', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t kVersion = 2;
+
+const uint64_t P1 = 0x9E3779B185EBCA87ull;
+const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t P3 = 0x165667B19E3779F9ull;
+const uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t merge64(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * P1 + P4;
+}
+
+// SheetRead <-> record payload: orientation byte, then counted,
+// length-prefixed entries.
+bool encodeRead(const ROIDetector::SheetRead& read, int orientation,
+                unsigned char* out, size_t cap, uint32_t& len) {
+    size_t n = 0;
+    auto put = [&](const void* p, size_t k) {
+        if (n + k > cap) return false;
+        std::memcpy(out + n, p, k);
+        n += k;
+        return true;
+    };
+    auto putByte = [&](size_t v) {
+        if (v > 255) return false;
+        unsigned char b = static_cast<unsigned char>(v);
+        return put(&b, 1);
+    };
+
+    if (orientation < 0 || !putByte(static_cast<size_t>(orientation))) return false;
+
+    if (!putByte(read.fields.size())) return false;
+    for (const auto& f : read.fields) {
+        if (!putByte(f.first.size()) || !put(f.first.data(), f.first.size())) return false;
+        if (!putByte(f.second.size()) || !put(f.second.data(), f.second.size())) return false;
+    }
+
+    if (!putByte(read.subjects.size())) return false;
+    for (const auto& s : read.subjects) {
+        if (!putByte(s.first.size()) || !put(s.first.data(), s.first.size())) return false;
+        if (!putByte(s.second.size()) || !put(s.second.codes.data(), s.second.size())) return false;
+    }
+
+    len = static_cast<uint32_t>(n);
+    return true;
+}
+
+bool decodeRead(const unsigned char* in, size_t len, ROIDetector::SheetRead& read, int& orientation) {
+    size_t n = 0;
+    auto getByte = [&](size_t& v) {
+        if (n + 1 > len) return false;
+        v = in[n++];
+        return true;
+    };
+    auto getStr = [&](std::string& s) {
+        size_t k;
+        if (!getByte(k) || n + k > len) return false;
+        s.assign(reinterpret_cast<const char*>(in + n), k);
+        n += k;
+        return true;
+    };
+
+    read.fields.clear();
+    read.subjects.clear();
+
+    size_t turns;
+    if (!getByte(turns) || turns > 3) return false;
+    orientation = static_cast<int>(turns);
+
+    size_t count;
+    if (!getByte(count)) return false;
+    for (size_t i = 0; i < count; ++i) {
+        std::string name, value;
+        if (!getStr(name) || !getStr(value)) return false;
+        read.fields[name] = value;
+    }
+
+    if (!getByte(count)) return false;
+    for (size_t i = 0; i < count; ++i) {
+        std::string name;
+        size_t k;
+        if (!getStr(name) || !getByte(k) || n + k > len || k > AnswerVector::kCapacity) return false;
+        AnswerVector& v = read.subjects[name];
+        for (size_t q = 0; q < k; ++q) v.push(in[n + q]);
+        n += k;
+    }
+    return true;
+}
+
+}
+
+uint64_t ResultCache::hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = round64(v1, read64(p));      p += 8;
+            v2 = round64(v2, read64(p));      p += 8;
+            v3 = round64(v3, read64(p));      p += 8;
+            v4 = round64(v4, read64(p));      p += 8;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge64(h, v1);
+        h = merge64(h, v2);
+        h = merge64(h, v3);
+        h = merge64(h, v4);
+    } else {
+        h = seed + P5;
+    }
+
+    h += static_cast<uint64_t>(size);
+
+    while (p + 8 <= end) {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+ResultCache::Header* ResultCache::header() const {
+    return reinterpret_cast<Header*>(file_.mutableData());
+}
+
+ResultCache::Record* ResultCache::record(uint64_t slot) const {
+    return reinterpret_cast<Record*>(file_.mutableData() + sizeof(Header) + slot * kRecordSize);
+}
+
+bool ResultCache::open(const std::string& path, size_t maxBytes) {
+    static_assert(sizeof(Header) == 64, "cache header layout");
+    static_assert(sizeof(Record) == kRecordSize, "cache record layout");
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    file_.close();
+
+    capacity_ = std::max<uint64_t>(kProbeWindow, (maxBytes > sizeof(Header) ? maxBytes - sizeof(Header) : 0) / kRecordSize);
+    size_t bytes = sizeof(Header) + static_cast<size_t>(capacity_) * kRecordSize;
+
+    if (!file_.openReadWrite(path, bytes)) return false;
+
+    Header* h = header();
+    if (std::memcmp(h->magic, kMagic, 8) != 0 || h->version != kVersion ||
+        h->recordSize != kRecordSize || h->capacity != capacity_) {
+        // New file or different geometry: start empty.
+        std::memset(file_.mutableData(), 0, bytes);
+        std::memcpy(h->magic, kMagic, 8);
+        h->version = kVersion;
+        h->recordSize = kRecordSize;
+        h->capacity = capacity_;
+        h->tick = 0;
+    }
+    return true;
+}
+
+void ResultCache::close() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    file_.close();
+}
+
+bool ResultCache::lookup(uint64_t key, ROIDetector::SheetRead& out, int* orientation) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!file_.isOpen()) return false;
+    if (key == 0) key = 1;
+
+    uint64_t home = key % capacity_;
+    for (int i = 0; i < kProbeWindow; ++i) {
+        Record* r = record((home + i) % capacity_);
+        if (r->key == 0) break;
+        if (r->key != key) continue;
+
+        // The file may be damaged or foreign; never trust its lengths.
+        int turns = 0;
+        if (r->length > sizeof(r->payload) || !decodeRead(r->payload, r->length, out, turns)) break;
+        if (orientation) *orientation = turns;
+        r->lastUse = ++header()->tick;
+        stats_.hits++;
+        return true;
+    }
+
+    stats_.misses++;
+    return false;
+}
+
+void ResultCache::store(uint64_t key, const ROIDetector::SheetRead& read, int orientation) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!file_.isOpen()) return;
+    if (key == 0) key = 1;
+
+    Record staged;
+    if (!encodeRead(read, orientation, staged.payload, sizeof(staged.payload), staged.length)) return;
+
+    uint64_t home = key % capacity_;
+    Record* target = nullptr;
+    bool evicting = true;
+
+    for (int i = 0; i < kProbeWindow; ++i) {
+        Record* r = record((home + i) % capacity_);
+        if (r->key == key || r->key == 0) {
+            target = r;
+            evicting = false;
+            break;
+        }
+        if (!target || r->lastUse < target->lastUse) target = r;
+    }
+
+    if (evicting) stats_.evictions++;
+
+    // Clear the key first so a torn write is never read back as valid.
+    target->key = 0;
+    target->length = staged.length;
+    std::memcpy(target->payload, staged.payload, staged.length);
+    target->lastUse = ++header()->tick;
+    target->key = key;
+    stats_.stores++;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+}
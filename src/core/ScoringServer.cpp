@@ -0,0 +1,388 @@
+#include "core/ScoringServer.hpp"
+#include "core/SheetPipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+
+namespace {
+
+#ifdef _WIN32
+struct WinsockInit {
+    WinsockInit() { WSADATA d; WSAStartup(MAKEWORD(2, 2), &d); }
+    ~WinsockInit() { WSACleanup(); }
+};
+static WinsockInit winsockInit;
+
+void closeSocket(long long s) { closesocket(static_cast<SOCKET>(s)); }
+void shutdownSocket(long long s) { ::shutdown(static_cast<SOCKET>(s), SD_BOTH); }
+#else
+void closeSocket(long long s) { ::close(static_cast<int>(s)); }
+void shutdownSocket(long long s) { ::shutdown(static_cast<int>(s), SHUT_RDWR); }
+#endif
+
+bool readFull(long long s, void* dst, size_t n) {
+    char* p = static_cast<char*>(dst);
+    while (n > 0) {
+        int got = ::recv(static_cast<int>(s), p, static_cast<int>(std::min<size_t>(n, 1 << 20)), 0);
+        if (got <= 0) return false;
+        p += got;
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool writeFull(long long s, const void* src, size_t n) {
+    const char* p = static_cast<const char*>(src);
+    while (n > 0) {
+        int sent = ::send(static_cast<int>(s), p, static_cast<int>(std::min<size_t>(n, 1 << 20)), 0);
+        if (sent <= 0) return false;
+        p += sent;
+        n -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool readLength(long long s, uint32_t& len) {
+    unsigned char hdr[4];
+    if (!readFull(s, hdr, 4)) return false;
+    len = (uint32_t(hdr[0]) << 24) | (uint32_t(hdr[1]) << 16) |
+          (uint32_t(hdr[2]) << 8) | uint32_t(hdr[3]);
+    return true;
+}
+
+bool readFrame(long long s, std::vector<unsigned char>& body, uint32_t maxLen) {
+    uint32_t len;
+    if (!readLength(s, len) || len > maxLen) return false;
+    body.resize(len);
+    return len == 0 || readFull(s, body.data(), len);
+}
+
+bool writeFrame(long long s, const void* body, size_t size) {
+    uint32_t len = static_cast<uint32_t>(size);
+    unsigned char hdr[4] = {
+        static_cast<unsigned char>(len >> 24), static_cast<unsigned char>(len >> 16),
+        static_cast<unsigned char>(len >> 8), static_cast<unsigned char>(len)
+    };
+    return writeFull(s, hdr, 4) && writeFull(s, body, size);
+}
+
+std::string errorReply(const std::string& error) {
+    return nlohmann::json{{"ok", false}, {"error", error}}.dump();
+}
+
+}
+
+void LatencyStats::record(double ms) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (samples_.size() < kCapacity) {
+        samples_.push_back(ms);
+    } else {
+        samples_[head_] = ms;
+        head_ = (head_ + 1) % kCapacity;
+    }
+    count_++;
+}
+
+LatencyStats::Summary LatencyStats::summary() const {
+    std::vector<double> v;
+    Summary s;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        v = samples_;
+        s.count = count_;
+    }
+    if (v.empty()) return s;
+
+    auto pct = [&v](double q) {
+        size_t k = std::min(v.size() - 1, static_cast<size_t>(q * (v.size() - 1) + 0.5));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    };
+    s.p50 = pct(0.50);
+    s.p90 = pct(0.90);
+    s.p99 = pct(0.99);
+    s.max = *std::max_element(v.begin(), v.end());
+    return s;
+}
+
+ScoringServer::ScoringServer(const PerspectiveCorrector& corrector,
+                             const AnswerKey& answerKey,
+                             double fillThreshold,
+                             int workers,
+                             ResultCache* cache)
+    : corrector_(corrector), answerKey_(answerKey), fillThreshold_(fillThreshold), cache_(cache) {
+    int n = workers > 0 ? workers : std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < n; ++i) workers_.emplace_back(&ScoringServer::workerLoop, this);
+}
+
+ScoringServer::~ScoringServer() {
+    stop();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void ScoringServer::stop() {
+    stopping_ = true;
+    queueCv_.notify_all();
+
+    long long ls = listenSocket_.exchange(-1);
+    if (ls >= 0) {
+        shutdownSocket(ls);
+        closeSocket(ls);
+    }
+
+    std::list<std::unique_ptr<Connection>> open;
+    {
+        std::lock_guard<std::mutex> lock(connMtx_);
+        open.swap(connections_);
+    }
+    for (auto& c : open) shutdownSocket(c->sock);
+    for (auto& c : open) {
+        if (c->thread.joinable()) c->thread.join();
+        closeSocket(c->sock);
+    }
+}
+
+void ScoringServer::requestStop() {
+    stopping_ = true;
+    long long ls = listenSocket_.load();
+    if (ls >= 0) shutdownSocket(ls);
+}
+
+void ScoringServer::reapConnections() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (!(*it)->done) {
+            ++it;
+            continue;
+        }
+        (*it)->thread.join();
+        closeSocket((*it)->sock);
+        it = connections_.erase(it);
+    }
+}
+
+void ScoringServer::workerLoop() {
+    // Per-worker pipeline: the detector is stateful, the corrector and key are shared.
+    SheetPipeline pipeline(corrector_, answerKey_, fillThreshold_);
+    pipeline.setCache(cache_);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMtx_);
+            queueCv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        std::string reply;
+        try {
+            SheetReport rep = pipeline.runEncoded(job.payload.data(), job.payload.size());
+            reply = SheetPipeline::toJson(rep).dump();
+        } catch (const std::exception& e) {
+            reply = errorReply(std::string("internal error: ") + e.what());
+        }
+        job.reply.set_value(std::move(reply));
+    }
+}
+
+std::string ScoringServer::submit(std::vector<unsigned char>&& payload) {
+    Job job;
+    job.payload = std::move(payload);
+    std::future<std::string> fut = job.reply.get_future();
+    {
+        // Workers leave only once stopping_ is set and the queue is empty,
+        // both seen under this lock, so an accepted job always gets a reply.
+        std::lock_guard<std::mutex> lock(queueMtx_);
+        if (stopping_) return errorReply("server stopping");
+        queue_.push_back(std::move(job));
+    }
+    queueCv_.notify_one();
+    return fut.get();
+}
+
+std::string ScoringServer::statsJson() const {
+    LatencyStats::Summary s = stats_.summary();
+    nlohmann::json j = {
+        {"requests", s.count},
+        {"workers", workers_.size()},
+        {"latency_ms", {{"p50", s.p50}, {"p90", s.p90}, {"p99", s.p99}, {"max", s.max}}}
+    };
+    if (cache_ && cache_->isOpen()) {
+        ResultCache::Stats cs = cache_->stats();
+        j["cache"] = {{"hits", cs.hits}, {"misses", cs.misses}, {"evictions", cs.evictions}};
+    }
+    return j.dump();
+}
+
+void ScoringServer::handleConnection(Connection* conn) {
+    const long long sock = conn->sock;
+    std::vector<unsigned char> body;
+    uint32_t len = 0;
+
+    while (!stopping_ && readLength(sock, len)) {
+        std::string reply;
+
+        if (len == 0) {
+            reply = statsJson();
+        } else {
+            // The body is read only once its bytes fit the shared budget; an
+            // over-size or over-budget request is refused and the connection
+            // closed, since its body is still unread on the socket.
+            bool admitted = len <= kMaxPayload;
+            if (admitted && bytesInFlight_.fetch_add(len) + len > kMaxBytesInFlight) {
+                bytesInFlight_ -= len;
+                admitted = false;
+            }
+            if (!admitted) {
+                reply = errorReply(len > kMaxPayload ? "payload too large" : "server busy");
+                writeFrame(sock, reply.data(), reply.size());
+                break;
+            }
+
+            bool ok = true;
+            try {
+                body.resize(len);
+                ok = readFull(sock, body.data(), len);
+                if (ok) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    reply = submit(std::move(body));
+                    stats_.record(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - t0).count());
+                }
+            } catch (const std::bad_alloc&) {
+                ok = false;
+                reply = errorReply("server busy");
+            }
+            body = std::vector<unsigned char>();
+            bytesInFlight_ -= len;
+            if (!ok) {
+                if (!reply.empty()) writeFrame(sock, reply.data(), reply.size());
+                break;
+            }
+        }
+
+        if (!writeFrame(sock, reply.data(), reply.size())) break;
+    }
+    conn->done = true;
+}
+
+bool ScoringServer::serve(const std::string& bindAddress, int port) {
+    long long ls = static_cast<long long>(::socket(AF_INET, SOCK_STREAM, 0));
+    if (ls < 0) {
+        std::cerr << "Soket acilamadi\n";
+        return false;
+    }
+
+    int yes = 1;
+    setsockopt(static_cast<int>(ls), SOL_SOCKET, SO_REUSEADDR,
+               reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, bindAddress.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "Gecersiz adres: " << bindAddress << "\n";
+        closeSocket(ls);
+        return false;
+    }
+
+    if (::bind(static_cast<int>(ls), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(static_cast<int>(ls), 64) != 0) {
+        std::cerr << "Port dinlenemiyor: " << bindAddress << ":" << port << "\n";
+        closeSocket(ls);
+        return false;
+    }
+
+    listenSocket_ = ls;
+    std::cout << "Puanlama servisi: " << bindAddress << ":" << port
+              << " (" << workers_.size() << " worker)" << std::endl;
+
+    while (!stopping_) {
+        sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        long long cs = static_cast<long long>(
+            ::accept(static_cast<int>(ls), reinterpret_cast<sockaddr*>(&peer), &peerLen));
+        if (cs < 0) {
+            if (stopping_) break;
+            continue;
+        }
+
+        int noDelay = 1;
+        setsockopt(static_cast<int>(cs), IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock(connMtx_);
+        reapConnections();
+        if (stopping_ || connections_.size() >= kMaxConnections) {
+            closeSocket(cs);
+            continue;
+        }
+        connections_.push_back(std::make_unique<Connection>());
+        Connection* conn = connections_.back().get();
+        conn->sock = cs;
+        conn->thread = std::thread(&ScoringServer::handleConnection, this, conn);
+    }
+
+    stop();
+    return true;
+}
+
+ScoringClient::~ScoringClient() {
+    close();
+}
+
+bool ScoringClient::connect(const std::string& host, int port) {
+    close();
+
+    long long s = static_cast<long long>(::socket(AF_INET, SOCK_STREAM, 0));
+    if (s < 0) return false;
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+        ::connect(static_cast<int>(s), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        closeSocket(s);
+        return false;
+    }
+
+    sock_ = s;
+    return true;
+}
+
+bool ScoringClient::request(const std::vector<unsigned char>& payload, std::string& reply) {
+    if (sock_ < 0) return false;
+
+    std::vector<unsigned char> in;
+    if (!writeFrame(sock_, payload.data(), payload.size()) || !readFrame(sock_, in, ScoringServer::kMaxPayload)) return false;
+
+    reply.assign(in.begin(), in.end());
+    return true;
+}
+
+void ScoringClient::close() {
+    if (sock_ >= 0) closeSocket(sock_);
+    sock_ = -1;
+}
+
+}
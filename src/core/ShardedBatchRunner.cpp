@@ -0,0 +1,229 @@
+#include "core/ShardedBatchRunner.hpp"
+#include "core/SheetPipeline.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace core {
+
+namespace {
+
+// Number of complete lines in a shard part file; a torn last line left by a
+// dying worker is cut off.
+size_t completeLines(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    size_t lines = static_cast<size_t>(std::count(data.begin(), data.end(), '\n'));
+    size_t keep = data.empty() ? 0 : data.find_last_of('\n') + 1;
+    if (keep != data.size()) {
+        std::error_code ec;
+        fs::resize_file(path, keep, ec);
+    }
+    return lines;
+}
+
+void appendFailure(const std::string& path, size_t index, const std::string& file, const std::string& why) {
+    nlohmann::json j = {
+        {"ok", false},
+        {"error", why},
+        {"index", index},
+        {"file", file}
+    };
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out << j.dump() << '\n';
+}
+
+}
+
+ShardedBatchRunner::ShardedBatchRunner(const PerspectiveCorrector& corrector,
+                                       const AnswerKey& answerKey,
+                                       BatchOptions options)
+    : corrector_(corrector), answerKey_(answerKey), opt_(std::move(options)) {}
+
+std::string ShardedBatchRunner::shardPath(size_t shard, bool done) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "shard-%06zu.%s", shard, done ? "jsonl" : "part");
+    return (fs::path(opt_.outPath + ".shards") / name).string();
+}
+
+int ShardedBatchRunner::runShardRange(const std::string& partPath, size_t begin, size_t end) {
+    BatchOptions o = opt_;
+    o.outPath = partPath;
+    o.begin = begin;
+    o.end = end;
+    o.append = true;
+    o.quiet = true;
+    // The cache file is not safe for concurrent writers in separate processes.
+    o.cachePath.clear();
+#ifndef _WIN32
+    if (o.cv.cvThreads <= 0) o.cv.cvThreads = autoCvThreads(opt_.workers, false);
+#endif
+
+    BatchRunner runner(corrector_, answerKey_, o);
+    return runner.run();
+}
+
+bool ShardedBatchRunner::merge(size_t shardCount) {
+    std::string tmp = opt_.outPath + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        for (size_t s = 0; s < shardCount; ++s) {
+            std::ifstream in(shardPath(s, true), std::ios::binary);
+            if (!in) return false;
+            out << in.rdbuf();
+        }
+        if (!out.good()) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, opt_.outPath, ec);
+    if (ec) return false;
+
+    fs::remove_all(opt_.outPath + ".shards", ec);
+    return true;
+}
+
+int ShardedBatchRunner::run() {
+    const size_t n = opt_.inputs.size();
+    const int workers = std::max(1, opt_.workers);
+
+    size_t shardSize = opt_.shardSize;
+    if (shardSize == 0) shardSize = std::max<size_t>(1, (n + workers * 8 - 1) / (workers * 8));
+    const size_t shardCount = (n + shardSize - 1) / shardSize;
+
+    std::error_code ec;
+    fs::create_directories(opt_.outPath + ".shards", ec);
+
+    std::vector<size_t> pending;
+    for (size_t s = 0; s < shardCount; ++s) {
+        if (fs::exists(shardPath(s, true), ec)) continue;
+        fs::remove(shardPath(s, false), ec);
+        pending.push_back(s);
+    }
+
+    // Created here, before any worker, so workers only ever reopen it.
+    if (!opt_.fillsPath.empty()) {
+        FillTensorFile fills;
+        SheetPipeline pipeline(corrector_, answerKey_, opt_.fillThreshold);
+        if (!BatchRunner::openFills(fills, opt_, pipeline, pending.size() < shardCount))
+            std::cerr << "Olcum dosyasi acilamadi: " << opt_.fillsPath << "\n";
+    }
+
+    std::cout << "Parcali toplu islem: " << n << " form, " << shardCount << " parca ("
+              << (shardCount - pending.size()) << " onceden tamam), " << workers << " surec\n";
+
+    auto shardBegin = [&](size_t s) { return s * shardSize; };
+    auto shardEnd = [&](size_t s) { return std::min(n, (s + 1) * shardSize); };
+
+    size_t failedShards = 0;
+
+#ifdef _WIN32
+    // No fork(): score shards in-process, still resumable through the shard files.
+    for (size_t s : pending) {
+        if (runShardRange(shardPath(s, false), shardBegin(s), shardEnd(s)) != 0) {
+            failedShards++;
+            continue;
+        }
+        fs::rename(shardPath(s, false), shardPath(s, true), ec);
+    }
+#else
+    std::map<pid_t, size_t> running;
+    size_t next = 0;
+
+    auto spawn = [&](size_t s, size_t from) -> bool {
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            int rc = runShardRange(shardPath(s, false), from, shardEnd(s));
+            std::_Exit(rc);
+        }
+        running[pid] = s;
+        return true;
+    };
+
+    while (next < pending.size() || !running.empty()) {
+        while (next < pending.size() && static_cast<int>(running.size()) < workers) {
+            size_t s = pending[next++];
+            if (!spawn(s, shardBegin(s))) {
+                std::cerr << "Surec baslatilamadi, parca " << s << "\n";
+                failedShards++;
+            }
+        }
+        if (running.empty()) break;
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+        size_t s = it->second;
+        running.erase(it);
+
+        const std::string part = shardPath(s, false);
+        size_t done = shardBegin(s) + completeLines(part);
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && done >= shardEnd(s)) {
+            fs::rename(part, shardPath(s, true), ec);
+            continue;
+        }
+
+        // A worker that exits on its own (e.g. cannot open its .part file)
+        // would fail the same way again on every input: fail the shard once
+        // and leave it for a rerun.
+        if (!WIFSIGNALED(status) || done >= shardEnd(s)) {
+            if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+                std::cerr << "Parca " << s << " tamamlanamadi (cikis kodu " << WEXITSTATUS(status) << ")\n";
+            failedShards++;
+            continue;
+        }
+
+        // The worker crashed on input `done`: record it and continue after it.
+        std::string why = "worker crashed (signal " + std::to_string(WTERMSIG(status)) + ")";
+        std::cerr << opt_.inputs[done] << ": " << why << "\n";
+        appendFailure(part, done, opt_.inputs[done], why);
+
+        if (done + 1 >= shardEnd(s)) {
+            fs::rename(part, shardPath(s, true), ec);
+        } else if (!spawn(s, done + 1)) {
+            failedShards++;
+        }
+    }
+#endif
+
+    if (failedShards > 0) {
+        std::cerr << failedShards << " parca tamamlanamadi; tekrar calistirinca kaldigi yerden devam eder\n";
+        return 1;
+    }
+
+    if (!merge(shardCount)) {
+        std::cerr << "Parcalar birlestirilemedi: " << opt_.outPath << "\n";
+        return 1;
+    }
+
+    std::cout << "Sonuclar: " << opt_.outPath << "\n";
+    return 0;
+}
+
+}
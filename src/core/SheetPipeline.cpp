@@ -0,0 +1,164 @@
+#include "core/SheetPipeline.hpp"
+#include "core/CvBackend.hpp"
+#include <chrono>
+
+namespace core {
+
+SheetPipeline::SheetPipeline(const PerspectiveCorrector& corrector,
+                             const AnswerKey& answerKey,
+                             double fillThreshold)
+    : corrector_(corrector), answerKey_(answerKey) {
+    detector_.setFillThreshold(fillThreshold);
+    if (const float* booklet = answerKey.bookletRegion()) detector_.setBookletRegion(booklet);
+}
+
+void SheetPipeline::setRegionWarp(bool enabled) {
+    regionWarp_ = enabled;
+    regionRects_.clear();
+    if (enabled)
+        regionRects_ = detector_.regionRects(cv::Size(corrector_.outWidth(), corrector_.outHeight()));
+}
+
+SheetReport SheetPipeline::run(const cv::Mat& bgr) {
+    auto t0 = std::chrono::steady_clock::now();
+    SheetReport rep;
+
+    if (bgr.empty()) {
+        rep.error = "empty image";
+    } else {
+        // A throwing warp or read (cv::Exception, bad_alloc) fails this sheet
+        // only; callers are worker threads that must keep running.
+        try {
+            WarpResult W;
+            {
+                ScopedCvThreads stage(warpThreads_);
+                W = regionWarp_ ? corrector_.findAndWarpRegions(bgr, regionRects_, false)
+                                : corrector_.findAndWarp(bgr, false);
+            }
+            if (!W.ok || W.warped.empty()) {
+                rep.error = (W.quality > 0.0) ? "low marker quality" : "paper not found";
+            } else {
+                rep.orientation = W.orientation;
+                ROIDetector::SheetRead read;
+                {
+                    ScopedCvThreads stage(readThreads_);
+                    read = detector_.process(W.warped, debugScratch_);
+                }
+                rep.fields = std::move(read.fields);
+                rep.subjects = std::move(read.subjects);
+                rep.answerThreshold = read.answerThreshold;
+                rep.calibrated = read.calibrated;
+                rep.cellFills = std::move(read.cellFills);
+                rep.score = answerKey_.calculateScore(rep.subjects, AnswerKey::bookletFromFields(rep.fields));
+                rep.ok = true;
+            }
+        } catch (const std::exception& e) {
+            rep = SheetReport();
+            rep.error = std::string("read failed: ") + e.what();
+        }
+    }
+
+    rep.elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return rep;
+}
+
+SheetReport SheetPipeline::runEncoded(const unsigned char* data, size_t size) {
+    if (!data || size == 0) {
+        SheetReport rep;
+        rep.error = "empty payload";
+        return rep;
+    }
+
+    uint64_t cacheKey = 0;
+    if (cache_) {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t seed = detector_.configFingerprint() ^
+                        ((static_cast<uint64_t>(corrector_.outWidth()) << 32) |
+                         static_cast<uint64_t>(corrector_.outHeight())) ^
+                        (regionWarp_ ? 0x9E3779B97F4A7C15ull : 0ull) ^
+                        (corrector_.hasOrientationLayout() ? 0xC2B2AE3D27D4EB4Full : 0ull);
+        cacheKey = ResultCache::hashBytes(data, size, seed);
+
+        ROIDetector::SheetRead read;
+        int orientation = 0;
+        if (cache_->lookup(cacheKey, read, &orientation)) {
+            SheetReport rep;
+            rep.orientation = orientation;
+            rep.fields = std::move(read.fields);
+            rep.subjects = std::move(read.subjects);
+            rep.score = answerKey_.calculateScore(rep.subjects, AnswerKey::bookletFromFields(rep.fields));
+            rep.ok = true;
+            rep.cached = true;
+            rep.elapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+            return rep;
+        }
+    }
+
+    cv::Mat buf(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+    cv::Mat bgr;
+    try {
+        bgr = cv::imdecode(buf, cv::IMREAD_COLOR);
+    } catch (const std::exception&) {
+        bgr.release();
+    }
+
+    if (bgr.empty()) {
+        SheetReport rep;
+        rep.error = "image decode failed";
+        return rep;
+    }
+
+    SheetReport rep = run(bgr);
+    if (cache_ && rep.ok) {
+        ROIDetector::SheetRead read;
+        read.fields = rep.fields;
+        read.subjects = rep.subjects;
+        cache_->store(cacheKey, read, rep.orientation);
+    }
+    return rep;
+}
+
+nlohmann::json SheetPipeline::toJson(const SheetReport& report) {
+    nlohmann::json j;
+    j["ok"] = report.ok;
+    j["elapsed_ms"] = report.elapsedMs;
+    if (report.cached) j["cached"] = true;
+
+    if (!report.ok) {
+        j["error"] = report.error;
+        return j;
+    }
+
+    if (report.orientation != 0) j["rotation_deg"] = report.orientation * 90;
+    j["fields"] = report.fields;
+    if (report.score.booklet) j["booklet"] = std::string(1, report.score.booklet);
+    if (report.score.bookletMissing) j["booklet_missing"] = true;
+
+    nlohmann::json answers = nlohmann::json::object();
+    for (const auto& s : report.subjects) answers[s.first] = s.second.toCsv();
+    j["answers"] = answers;
+
+    nlohmann::json subjects = nlohmann::json::object();
+    for (const auto& s : report.score.subjectDetails) {
+        subjects[s.first] = {
+            {"correct", s.second.correct},
+            {"wrong", s.second.wrong},
+            {"empty", s.second.empty},
+            {"net", s.second.net}
+        };
+    }
+
+    j["score"] = {
+        {"questions", report.score.totalQuestions},
+        {"correct", report.score.totalCorrect},
+        {"wrong", report.score.totalWrong},
+        {"empty", report.score.totalEmpty},
+        {"net", report.score.totalScore},
+        {"subjects", subjects}
+    };
+    return j;
+}
+
+}
@@ -0,0 +1,82 @@
+#include "core/TaskPool.hpp"
+#include <algorithm>
+
+namespace core {
+
+TaskPool::TaskPool(int threads) {
+    const int extra = std::max(0, threads - 1);
+    workers_.reserve(extra);
+    for (int i = 0; i < extra; ++i)
+        workers_.emplace_back(&TaskPool::workerLoop, this);
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    startCv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void TaskPool::drain() {
+    for (int i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) {
+        try {
+            (*job_)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (!error_) error_ = std::current_exception();
+        }
+    }
+}
+
+void TaskPool::workerLoop() {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            startCv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (--running_ == 0) doneCv_.notify_one();
+    }
+}
+
+void TaskPool::parallelFor(int n, const std::function<void(int)>& fn) {
+    if (n <= 0) return;
+
+    if (workers_.empty() || n == 1) {
+        for (int i = 0; i < n; ++i) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        job_ = &fn;
+        count_ = n;
+        next_.store(0);
+        running_ = static_cast<int>(workers_.size());
+        error_ = nullptr;
+        ++generation_;
+    }
+    startCv_.notify_all();
+
+    drain();
+
+    std::exception_ptr err;
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        doneCv_.wait(lk, [&] { return running_ == 0; });
+        job_ = nullptr;
+        err = error_;
+        error_ = nullptr;
+    }
+    if (err) std::rethrow_exception(err);
+}
+
+} // namespace core
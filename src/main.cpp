@@ -2,12 +2,29 @@
 #include "PerspectiveCorrector.hpp"
 #include "ROIDetector.hpp"
 #include "AnswerKey.hpp"
+#include "AutoCapture.hpp"
+#include "LiveScheduler.hpp"
+#include "ScoringServer.hpp"
+#include "BatchRunner.hpp"
+#include "ShardedBatchRunner.hpp"
+#include "ExamStats.hpp"
+#include "SheetPipeline.hpp"
+#include "CvBackend.hpp"
 
 #include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <map>
+#include <thread>
 #include <vector>
 
 using namespace cv;
@@ -29,7 +46,9 @@ static void drawScoreOverlay(cv::Mat& frame, const AnswerKey::ScoreResult& score
         cv::addWeighted(color, 0.8, roi, 0.2, 0, roi);
     }
 
-    cv::putText(frame, "PUANLAMA DETAYI", cv::Point(startX, startY),
+    std::string title = "PUANLAMA DETAYI";
+    if (score.booklet) title += std::string(" (") + score.booklet + (score.bookletMissing ? "?)" : ")");
+    cv::putText(frame, title, cv::Point(startX, startY),
                 cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 255), 3);
 
     startY += 50;
@@ -79,26 +98,697 @@ static void drawScoreOverlay(cv::Mat& frame, const AnswerKey::ScoreResult& score
     }
 }
 
-static void addSubjectKey(std::vector<AnswerKey::QuestionAnswer>& out,
-                          const std::string& subject,
-                          const std::string& key) {
-    for (int i = 0; i < static_cast<int>(key.size()); ++i) {
-        out.push_back({subject, i, key[i]}); 
+static const char* kDefaultKeyPath = "cevap_anahtari.txt";
+
+static bool loadAnswerKey(AnswerKey& answerKey, const std::string& path) {
+    std::string error;
+    if (!answerKey.loadFromFile(path, &error)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+// OpenCV threads left for each of n concurrent region reads.
+static core::CvBudget regionReadBudget(int regionThreads) {
+    core::CvBudget budget;
+    if (regionThreads > 1) budget.cvThreads = std::max(1, core::cpuCount() / regionThreads);
+    return budget;
+}
+
+static bool readFileBytes(const std::string& path, std::vector<unsigned char>& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool splitHostPort(const std::string& s, std::string& host, int& port) {
+    size_t colon = s.rfind(':');
+    if (colon == std::string::npos) {
+        host = "127.0.0.1";
+        port = std::atoi(s.c_str());
+    } else {
+        host = s.substr(0, colon);
+        port = std::atoi(s.c_str() + colon + 1);
+    }
+    return port > 0 && port < 65536;
+}
+
+// Lets the corner finder tell an upside-down sheet from an upright one by
+// where the printed regions land.
+static void enableAutoOrientation(core::PerspectiveCorrector& pc) {
+    pc.setOrientationLayout(ROIDetector().regionRects(cv::Size(pc.outWidth(), pc.outHeight())));
+}
+
+static core::ScoringServer* g_server = nullptr;
+
+static void onStopSignal(int) {
+    if (g_server) g_server->requestStop();
+}
+
+// omr --serve [port] [workers] [--cache file] [--cache-mb N] [--key file] [--cv-threads N]
+static int runServer(int argc, char** argv) {
+    int port = 5050;
+    int workers = 0;
+    std::string cachePath;
+    std::string keyPath = kDefaultKeyPath;
+    size_t cacheMb = 256;
+    core::CvBudget cv;
+
+    int positional = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (a == "--cache-mb" && i + 1 < argc) cacheMb = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else if (a == "--cv-threads" && i + 1 < argc) cv.cvThreads = std::atoi(argv[++i]);
+        else if (positional == 0) { port = std::atoi(argv[i]); positional++; }
+        else if (positional == 1) { workers = std::atoi(argv[i]); positional++; }
+    }
+
+    // Workers are threads sharing OpenCV's pool: by default one sheet per
+    // core and OpenCV itself sequential.
+    if (workers <= 0) workers = core::cpuCount();
+    if (cv.cvThreads <= 0) cv.cvThreads = core::autoCvThreads(workers, true);
+    core::applyCvBudget(cv);
+
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+    AnswerKey answerKey;
+    if (!loadAnswerKey(answerKey, keyPath)) return 1;
+
+    core::ResultCache cache;
+    if (!cachePath.empty() && !cache.open(cachePath, cacheMb * 1024 * 1024)) {
+        std::cerr << "Onbellek acilamadi: " << cachePath << "\n";
+    }
+
+    core::ScoringServer server(pc, answerKey, 0.40, workers, cache.isOpen() ? &cache : nullptr);
+
+    // Ctrl+C / SIGTERM: finish the requests in hand, close connections, exit.
+    g_server = &server;
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    bool ok = server.serve("127.0.0.1", port);
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    g_server = nullptr;
+    if (ok) std::cout << "Puanlama servisi durduruldu" << std::endl;
+    return ok ? 0 : 1;
+}
+
+// omr --send [host:]port image...
+static int runClient(int argc, char** argv) {
+    std::string host;
+    int port = 0;
+    if (argc < 3 || !splitHostPort(argv[2], host, port)) {
+        std::cerr << "Kullanim: ./omr --send [host:]port goruntu...\n";
+        return 1;
+    }
+
+    core::ScoringClient client;
+    if (!client.connect(host, port)) {
+        std::cerr << "Servise baglanilamadi: " << host << ":" << port << "\n";
+        return 1;
+    }
+
+    std::vector<unsigned char> payload;
+    std::string reply;
+
+    for (int i = 3; i < argc; ++i) {
+        if (!readFileBytes(argv[i], payload) || payload.empty()) {
+            std::cerr << "Dosya okunamadi: " << argv[i] << "\n";
+            continue;
+        }
+        if (!client.request(payload, reply)) {
+            std::cerr << "Istek basarisiz: " << argv[i] << "\n";
+            return 1;
+        }
+        cout << argv[i] << "\t" << reply << "\n";
+    }
+
+    payload.clear();
+    if (client.request(payload, reply)) cout << "stats\t" << reply << "\n";
+    return 0;
+}
+
+// omr --batch input... [--out results.jsonl] [--prefetch K] [--workers N] [--shard-size S]
+//                       [--checkpoint-every N] [--restart] [--cache file] [--cache-mb N]
+//                       [--region-warp] [--fills file] [--key file]
+//                       [--cv-threads N] [--warp-threads N] [--read-threads N]
+static int runBatch(int argc, char** argv) {
+    core::BatchOptions opt;
+    opt.workers = 0;
+    std::vector<std::string> inputs;
+    std::string keyPath = kDefaultKeyPath;
+    bool restart = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--out" && i + 1 < argc) opt.outPath = argv[++i];
+        else if (a == "--prefetch" && i + 1 < argc) opt.prefetch = std::atoi(argv[++i]);
+        else if (a == "--workers" && i + 1 < argc) opt.workers = std::atoi(argv[++i]);
+        else if (a == "--shard-size" && i + 1 < argc) opt.shardSize = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--checkpoint-every" && i + 1 < argc) opt.checkpointEvery = std::atoi(argv[++i]);
+        else if (a == "--restart") restart = true;
+        else if (a == "--cache" && i + 1 < argc) opt.cachePath = argv[++i];
+        else if (a == "--cache-mb" && i + 1 < argc) opt.cacheBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        else if (a == "--region-warp") opt.regionWarp = true;
+        else if (a == "--fills" && i + 1 < argc) opt.fillsPath = argv[++i];
+        else if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else if (a == "--cv-threads" && i + 1 < argc) opt.cv.cvThreads = std::atoi(argv[++i]);
+        else if (a == "--warp-threads" && i + 1 < argc) opt.cv.warpThreads = std::atoi(argv[++i]);
+        else if (a == "--read-threads" && i + 1 < argc) opt.cv.readThreads = std::atoi(argv[++i]);
+        else inputs.push_back(a);
+    }
+
+    // Default: one worker process per core (the cache file cannot be shared
+    // between processes, so a cached run stays in one process).
+    if (opt.workers <= 0) opt.workers = opt.cachePath.empty() ? core::cpuCount() : 1;
+
+    opt.inputs = core::BatchRunner::expandInputs(inputs);
+    if (opt.inputs.empty()) {
+        std::cerr << "Kullanim: ./omr --batch <klasor|liste.txt|goruntu...> [--out sonuc.jsonl] [--prefetch K]"
+                     " [--workers N] [--shard-size S] [--checkpoint-every N] [--restart]"
+                     " [--cache dosya] [--cache-mb N] [--region-warp] [--fills olcum.bin]"
+                     " [--key cevap_anahtari.txt] [--cv-threads N] [--warp-threads N] [--read-threads N]\n";
+        return 1;
+    }
+
+    AnswerKey answerKey;
+    if (!loadAnswerKey(answerKey, keyPath)) return 1;
+
+    if (restart) {
+        std::error_code ec;
+        std::remove((opt.outPath + ".ckpt").c_str());
+        std::filesystem::remove_all(opt.outPath + ".shards", ec);
+    }
+
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+
+    if (opt.workers > 1 || opt.shardSize > 0) {
+        core::ShardedBatchRunner runner(pc, answerKey, opt);
+        return runner.run();
+    }
+
+    core::BatchRunner runner(pc, answerKey, opt);
+    return runner.run();
+}
+
+// omr --report results.jsonl... [--out report.json] [--threads N] [--key file]
+// Item statistics over scored batch results, without touching the images.
+static int runReport(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    std::string outPath = "rapor.json";
+    std::string keyPath = kDefaultKeyPath;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--out" && i + 1 < argc) outPath = argv[++i];
+        else if (a == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else inputs.push_back(a);
+    }
+    if (inputs.empty()) {
+        std::cerr << "Kullanim: ./omr --report sonuc.jsonl... [--out rapor.json] [--threads N]"
+                     " [--key cevap_anahtari.txt]\n";
+        return 1;
+    }
+
+    AnswerKey answerKey;
+    if (!loadAnswerKey(answerKey, keyPath)) return 1;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<core::ExamStats> stats;
+    for (char b : answerKey.booklets()) stats.emplace_back(answerKey, b);
+    size_t bad = core::ExamStats::addResultFiles(inputs, threads, stats);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    nlohmann::json report;
+    if (stats.size() == 1) {
+        report = stats[0].toJson();
+    } else {
+        for (const auto& st : stats) report["booklets"][std::string(1, st.booklet())] = st.toJson();
+    }
+
+    std::ofstream out(outPath, std::ios::trunc);
+    out << report.dump(2) << "\n";
+    if (!out.good()) {
+        std::cerr << "Rapor yazilamadi: " << outPath << "\n";
+        return 1;
+    }
+
+    uint64_t sheets = 0, unread = 0;
+    for (const auto& st : stats) {
+        sheets += st.sheets();
+        unread += st.unread();
+    }
+    cout << std::fixed << std::setprecision(2)
+         << "Form: " << sheets << " okunan, " << unread << " okunamayan";
+    if (bad) cout << ", " << bad << " bozuk satir";
+    cout << " (" << sec << " sn)\n";
+
+    for (const auto& st : stats) {
+        nlohmann::json sr = st.toJson();
+        if (stats.size() > 1) cout << "Kitapcik " << st.booklet() << " (" << st.sheets() << " form)\n";
+        cout << "Toplam net: ort " << sr["net"]["mean"].get<double>()
+             << ", ss " << sr["net"]["sd"].get<double>() << "\n";
+
+        for (const auto& s : sr["subjects"].items()) {
+            const auto& sj = s.value();
+            int hard = 0, weak = 0;
+            for (const auto& item : sj["items"]) {
+                if (item["difficulty"].get<double>() < 0.3) hard++;
+                if (item["discrimination"].is_number() && item["discrimination"].get<double>() < 0.2) weak++;
+            }
+            cout << std::left << std::setw(10) << s.key() << std::right
+                 << " net ort " << std::setw(6) << sj["mean"].get<double>()
+                 << "  ss " << std::setw(5) << sj["sd"].get<double>()
+                 << "  zor soru " << hard << "  ayirt edicilik<0.2: " << weak << "\n";
+        }
+    }
+    cout << "Rapor: " << outPath << "\n";
+    return 0;
+}
+
+// omr --bench-regions image [iterations]
+// Single-sheet read latency of ROIDetector at 1, 2, 4 and 8 region threads.
+static int runBenchRegions(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Kullanim: ./omr --bench-regions goruntu [tekrar]\n";
+        return 1;
+    }
+    int iterations = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 50;
+
+    cv::Mat img = cv::imread(argv[2], cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Goruntu okunamadi: " << argv[2] << "\n";
+        return 1;
+    }
+
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+    core::WarpResult W = pc.findAndWarp(img, false);
+    cv::Mat warped;
+    if (W.ok && !W.warped.empty()) {
+        warped = W.warped;
+    } else {
+        std::cerr << "Kagit bulunamadi, goruntu dogrudan olceklendi.\n";
+        cv::resize(img, warped, cv::Size(pc.outWidth(), pc.outHeight()));
+    }
+
+    ROIDetector detector;
+    detector.setFillThreshold(0.40);
+    cv::Mat debugOut;
+
+    ROIDetector::SheetRead reference = detector.process(warped, debugOut);
+
+    cout << "threads  median_ms  p90_ms  mean_ms  speedup  sonuc\n";
+    double baseMedian = 0.0;
+
+    for (int threads : {1, 2, 4, 8}) {
+        core::applyCvBudget(regionReadBudget(threads));
+        detector.setRegionThreads(threads);
+        for (int i = 0; i < 3; ++i) detector.process(warped, debugOut);
+
+        std::vector<double> ms;
+        ms.reserve(iterations);
+        bool same = true;
+        for (int i = 0; i < iterations; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            ROIDetector::SheetRead read = detector.process(warped, debugOut);
+            ms.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count());
+            if (read.fields != reference.fields || read.subjects.size() != reference.subjects.size()) same = false;
+            for (const auto& kv : read.subjects) {
+                auto it = reference.subjects.find(kv.first);
+                if (it == reference.subjects.end() || it->second.toCsv() != kv.second.toCsv()) same = false;
+            }
+        }
+
+        double mean = 0.0;
+        for (double v : ms) mean += v;
+        mean /= ms.size();
+        std::sort(ms.begin(), ms.end());
+        double median = ms[ms.size() / 2];
+        double p90 = ms[std::min(ms.size() - 1, ms.size() * 9 / 10)];
+        if (threads == 1) baseMedian = median;
+
+        cout << std::setw(7) << threads << "  "
+             << std::fixed << std::setprecision(2)
+             << std::setw(9) << median << "  "
+             << std::setw(6) << p90 << "  "
+             << std::setw(7) << mean << "  "
+             << std::setw(6) << (median > 0.0 ? baseMedian / median : 0.0) << "x  "
+             << (same ? "ayni" : "FARKLI") << "\n";
+    }
+
+    detector.setRegionThreads(1);
+    core::applyCvBudget(core::CvBudget());
+    return 0;
+}
+
+// omr --bench-warp image [iterations]
+// Full-page warp vs. warping only the read regions, and whether reads agree.
+static int runBenchWarp(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Kullanim: ./omr --bench-warp goruntu [tekrar]\n";
+        return 1;
+    }
+    int iterations = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 50;
+
+    cv::Mat img = cv::imread(argv[2], cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Goruntu okunamadi: " << argv[2] << "\n";
+        return 1;
+    }
+
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+    ROIDetector detector;
+    detector.setFillThreshold(0.40);
+    const std::vector<cv::Rect> rects = detector.regionRects(cv::Size(pc.outWidth(), pc.outHeight()));
+
+    auto timeIt = [&](bool regions, core::WarpResult& last) {
+        std::vector<double> ms;
+        ms.reserve(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            last = regions ? pc.findAndWarpRegions(img, rects, false) : pc.findAndWarp(img, false);
+            ms.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count());
+        }
+        std::sort(ms.begin(), ms.end());
+        return ms[ms.size() / 2];
+    };
+
+    core::WarpResult full, part, scratch;
+    double fullMs = timeIt(false, full);
+    double partMs = timeIt(true, part);
+    if (!full.ok || !part.ok) {
+        std::cerr << "Kagit bulunamadi.\n";
+        return 1;
     }
+
+    pc.setRemapCache(true);
+    double fullRemapMs = timeIt(false, scratch);
+    double partRemapMs = timeIt(true, scratch);
+    pc.setRemapCache(false);
+
+    double area = 0.0;
+    for (const auto& r : rects) area += r.area();
+    area /= static_cast<double>(pc.outWidth()) * pc.outHeight();
+
+    cv::Mat dbg;
+    ROIDetector::SheetRead a = detector.process(full.warped, dbg);
+    ROIDetector::SheetRead b = detector.process(part.warped, dbg);
+    int diff = 0;
+    for (const auto& kv : a.subjects) {
+        const AnswerVector& other = b.subjects[kv.first];
+        for (int q = 0; q < kv.second.size(); ++q)
+            if (kv.second[q] != other[q]) diff++;
+    }
+    for (const auto& kv : a.fields)
+        if (b.fields[kv.first] != kv.second) diff++;
+
+    cout << std::fixed << std::setprecision(2)
+         << "tam sayfa   : " << fullMs << " ms\n"
+         << "bolgeler    : " << partMs << " ms (sayfanin %" << area * 100.0 << "'i)\n"
+         << "hizlanma    : " << (partMs > 0.0 ? fullMs / partMs : 0.0) << "x\n"
+         << "tam + remap : " << fullRemapMs << " ms\n"
+         << "bolge+remap : " << partRemapMs << " ms\n"
+         << "farkli okuma: " << diff << "\n";
+    return 0;
 }
 
-static std::vector<std::string> splitCSV(const std::string& s) {
-    std::vector<std::string> out;
-    std::stringstream ss(s);
-    std::string tok;
-    while (std::getline(ss, tok, ',')) {
-        // trim
-        size_t a = 0, b = tok.size();
-        while (a < b && isspace((unsigned char)tok[a])) a++;
-        while (b > a && isspace((unsigned char)tok[b - 1])) b--;
-        out.push_back(tok.substr(a, b - a));
-    }
-    return out;
+// omr --bench-corners image [iterations]
+// Marker search time on the frame with increasing synthetic desk clutter.
+static int runBenchCorners(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Kullanim: ./omr --bench-corners goruntu [tekrar]\n";
+        return 1;
+    }
+    int iterations = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 30;
+
+    cv::Mat img = cv::imread(argv[2], cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Goruntu okunamadi: " << argv[2] << "\n";
+        return 1;
+    }
+
+    core::CornerFinder finder(1600, 2200);
+
+    cout << "parazit  kontur  aday  median_ms  p90_ms  kagit  kalite\n";
+    for (int clutter : {0, 250, 1000, 4000}) {
+        cv::Mat frame = img.clone();
+        cv::RNG rng(12345);
+        for (int i = 0; i < clutter; ++i) {
+            cv::Point p(rng.uniform(0, frame.cols), rng.uniform(0, frame.rows));
+            cv::Scalar ink = cv::Scalar::all(rng.uniform(0, 80));
+            switch (i % 3) {
+            case 0:
+                cv::circle(frame, p, rng.uniform(2, 12), ink, cv::FILLED);
+                break;
+            case 1:
+                cv::rectangle(frame, cv::Rect(p.x, p.y, rng.uniform(4, 30), rng.uniform(4, 30)),
+                              ink, cv::FILLED);
+                break;
+            default:
+                cv::line(frame, p, p + cv::Point(rng.uniform(-40, 40), rng.uniform(-40, 40)), ink, 2);
+                break;
+            }
+        }
+
+        core::CornerResult C;
+        std::vector<double> ms;
+        ms.reserve(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            C = finder.processFrame(frame, false, false);
+            ms.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count());
+        }
+        std::sort(ms.begin(), ms.end());
+
+        cout << std::setw(7) << clutter << "  "
+             << std::setw(6) << C.contour_count << "  "
+             << std::setw(4) << C.candidate_count << "  "
+             << std::fixed << std::setprecision(2)
+             << std::setw(9) << ms[ms.size() / 2] << "  "
+             << std::setw(6) << ms[std::min(ms.size() - 1, ms.size() * 9 / 10)] << "  "
+             << std::setw(5) << (C.paper_ok ? "evet" : "hayir") << "  "
+             << C.quality << "\n";
+    }
+    return 0;
+}
+
+// omr --bench-threshold image|dir... [--iter N]
+// Gaussian per-region adaptive threshold vs. the shared box-mean table over a
+// corpus: read latency and how often the two reads disagree.
+static int runBenchThreshold(int argc, char** argv) {
+    int iterations = 20;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--iter" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else paths.push_back(a);
+    }
+
+    std::vector<std::string> files;
+    for (const auto& p : paths) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(p, ec)) {
+            for (const auto& e : std::filesystem::directory_iterator(p, ec)) {
+                std::string ext = e.path().extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+                if (ext == ".jpg" || ext == ".jpeg" || ext == ".png") files.push_back(e.path().string());
+            }
+        } else {
+            files.push_back(p);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        std::cerr << "Kullanim: ./omr --bench-threshold goruntu|klasor... [--iter N]\n";
+        return 1;
+    }
+
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+    ROIDetector detector;
+    detector.setFillThreshold(0.40);
+
+    auto timeRead = [&](const cv::Mat& warped, ROIDetector::SheetRead& read) {
+        cv::Mat dbg;
+        std::vector<double> ms;
+        ms.reserve(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            read = detector.process(warped, dbg);
+            ms.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count());
+        }
+        std::sort(ms.begin(), ms.end());
+        return ms[ms.size() / 2];
+    };
+
+    int sheets = 0, questions = 0, answerDiff = 0, chars = 0, charDiff = 0;
+    double gaussTotal = 0.0, boxTotal = 0.0;
+
+    cout << "form                            gauss_ms  box_ms  hizlanma  cevap_fark  kimlik_fark\n";
+    for (const auto& f : files) {
+        cv::Mat img = cv::imread(f, cv::IMREAD_COLOR);
+        core::WarpResult W = img.empty() ? core::WarpResult() : pc.findAndWarp(img, false);
+        if (!W.ok) {
+            cout << std::left << std::setw(32) << std::filesystem::path(f).filename().string()
+                 << std::right << "kagit bulunamadi\n";
+            continue;
+        }
+
+        ROIDetector::SheetRead g, b;
+        detector.setThresholdMethod(ROIDetector::Gaussian);
+        double gMs = timeRead(W.warped, g);
+        detector.setThresholdMethod(ROIDetector::BoxMean);
+        double bMs = timeRead(W.warped, b);
+
+        int aDiff = 0, cDiff = 0;
+        for (const auto& kv : g.subjects) {
+            const AnswerVector& other = b.subjects[kv.first];
+            for (int q = 0; q < kv.second.size(); ++q) {
+                questions++;
+                if (kv.second[q] != other[q]) aDiff++;
+            }
+        }
+        for (const auto& kv : g.fields) {
+            const std::string& other = b.fields[kv.first];
+            size_t n = std::max(kv.second.size(), other.size());
+            for (size_t i = 0; i < n; ++i) {
+                chars++;
+                if (i >= kv.second.size() || i >= other.size() || kv.second[i] != other[i]) cDiff++;
+            }
+        }
+
+        sheets++;
+        answerDiff += aDiff;
+        charDiff += cDiff;
+        gaussTotal += gMs;
+        boxTotal += bMs;
+
+        cout << std::left << std::setw(32) << std::filesystem::path(f).filename().string() << std::right
+             << std::fixed << std::setprecision(2)
+             << std::setw(8) << gMs << "  "
+             << std::setw(6) << bMs << "  "
+             << std::setw(7) << (bMs > 0.0 ? gMs / bMs : 0.0) << "x  "
+             << std::setw(10) << aDiff << "  "
+             << std::setw(11) << cDiff << "\n";
+    }
+
+    if (sheets == 0) return 1;
+    cout << std::fixed << std::setprecision(2)
+         << "\nform sayisi      : " << sheets << "\n"
+         << "ortalama gauss   : " << gaussTotal / sheets << " ms\n"
+         << "ortalama box     : " << boxTotal / sheets << " ms\n"
+         << "hizlanma         : " << (boxTotal > 0.0 ? gaussTotal / boxTotal : 0.0) << "x\n"
+         << "cevap uyumu      : %" << (questions ? 100.0 * (questions - answerDiff) / questions : 100.0)
+         << " (" << answerDiff << "/" << questions << " farkli)\n"
+         << "kimlik uyumu     : %" << (chars ? 100.0 * (chars - charDiff) / chars : 100.0)
+         << " (" << charDiff << "/" << chars << " farkli karakter)\n";
+    return 0;
+}
+
+// omr --bench-cv image|dir|list... [--iter N]
+// Sheets/sec of the same corpus under OpenCV-internal parallelism, sheet-level
+// workers and mixes of the two (workers are threads of this process).
+static int runBenchCv(int argc, char** argv) {
+    int iterations = 3;
+    std::vector<std::string> args;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--iter" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else args.push_back(a);
+    }
+
+    std::vector<std::string> files = core::BatchRunner::expandInputs(args);
+    std::vector<std::vector<unsigned char>> corpus;
+    for (const auto& f : files) {
+        std::vector<unsigned char> bytes;
+        if (readFileBytes(f, bytes) && !bytes.empty()) corpus.push_back(std::move(bytes));
+    }
+    if (corpus.empty()) {
+        std::cerr << "Kullanim: ./omr --bench-cv goruntu|klasor|liste.txt... [--iter N]\n";
+        return 1;
+    }
+
+    AnswerKey answerKey;
+    if (!answerKey.loadFromFile(kDefaultKeyPath)) answerKey.loadAnswerKey({});
+    core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+
+    struct Config {
+        std::string name;
+        int workers;
+        core::CvBudget cv;
+    };
+
+    const int cores = core::cpuCount();
+    std::vector<Config> configs;
+    configs.push_back({"opencv", 1, {cores, 0, 0, false}});
+    configs.push_back({"opencv+asama", 1, {cores, cores, 1, false}});
+    for (int k = 2; k <= cores / 2; k *= 2) {
+        configs.push_back({"karma " + std::to_string(cores / k) + "x" + std::to_string(k), cores / k,
+                           {k, 0, 0, false}});
+    }
+    configs.push_back({"form", cores, {1, 0, 0, false}});
+
+    const size_t total = corpus.size() * iterations;
+    cout << corpus.size() << " form x " << iterations << " tur, " << cores << " cekirdek\n"
+         << "yapilandirma        isci  cv  form/sn  p50_ms  p90_ms\n";
+
+    double bestRate = 0.0;
+    std::string best;
+
+    for (const Config& c : configs) {
+        core::applyCvBudget(c.cv);
+
+        std::atomic<size_t> next{0};
+        std::vector<std::vector<double>> latency(c.workers);
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int w = 0; w < c.workers; ++w) {
+            threads.emplace_back([&, w] {
+                core::SheetPipeline pipeline(pc, answerKey);
+                if (c.workers == 1) pipeline.setStageThreads(c.cv.warpThreads, c.cv.readThreads);
+                for (size_t i; (i = next++) < total;) {
+                    const auto& bytes = corpus[i % corpus.size()];
+                    latency[w].push_back(pipeline.runEncoded(bytes.data(), bytes.size()).elapsedMs);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        std::vector<double> all;
+        for (const auto& l : latency) all.insert(all.end(), l.begin(), l.end());
+        std::sort(all.begin(), all.end());
+        double rate = sec > 0.0 ? total / sec : 0.0;
+        if (rate > bestRate) {
+            bestRate = rate;
+            best = c.name;
+        }
+
+        cout << std::left << std::setw(20) << c.name << std::right
+             << std::setw(4) << c.workers << std::setw(4) << c.cv.cvThreads
+             << std::fixed << std::setprecision(1)
+             << std::setw(9) << rate
+             << std::setw(8) << all[all.size() / 2]
+             << std::setw(8) << all[std::min(all.size() - 1, all.size() * 9 / 10)] << "\n";
+    }
+
+    cout << "En hizli: " << best << "\n";
+    return 0;
 }
 
 static std::string shortName(const std::string& subject) {
@@ -111,25 +801,6 @@ static std::string shortName(const std::string& subject) {
     return subject;
 }
 
-static char getStudentAnswerAt(const std::map<std::string, std::string>& studentAnswersCsv, const std::string& subject, int qIndex0) {
-    auto it = studentAnswersCsv.find(subject);
-    if (it == studentAnswersCsv.end()) return '-';
-
-    auto tokens = splitCSV(it->second);
-    if (qIndex0 < 0 || qIndex0 >= (int)tokens.size()) return '-';
-
-    std::string a = tokens[qIndex0];
-    if (a.empty()) return '-';
-
-    char c = a[0];
-    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
-
-    if (c == '-' || c == ' ') return '-';
-    if (c == 'X') return 'X';
-    return c; 
-}
-
-
 static std::string safeGet(const std::map<std::string, std::string>& m, const std::string& k) {
     auto it = m.find(k);
     if (it == m.end()) return "";
@@ -137,14 +808,14 @@ static std::string safeGet(const std::map<std::string, std::string>& m, const st
 }
 
 static void drawIdentityOverlay(cv::Mat& frame,
-                                const std::map<std::string, std::string>& studentAnswers,
+                                const std::map<std::string, std::string>& identityFields,
                                 cv::Point origin = {40, 80}) {
     int x = origin.x;
     int y = origin.y;
 
-    std::string tc   = safeGet(studentAnswers, "tc_kimlik");
-    std::string no   = safeGet(studentAnswers, "ogrenci_no");
-    std::string name = safeGet(studentAnswers, "adi_soyadi");
+    std::string tc   = safeGet(identityFields, "tc_kimlik");
+    std::string no   = safeGet(identityFields, "ogrenci_no");
+    std::string name = safeGet(identityFields, "adi_soyadi");
 
     cv::putText(frame, "KIMLIK BILGILERI",
                 {x, y},
@@ -179,8 +850,8 @@ static void drawIdentityOverlay(cv::Mat& frame,
 }
 
 static void drawComparisonOverlay(cv::Mat& frame,
-                                  const std::map<std::string, std::string>& studentAnswersCsv,
-                                  const std::map<std::string, std::map<int, char>>& answerKeyMap,
+                                  const std::map<std::string, AnswerVector>& studentAnswers,
+                                  const AnswerKey::CompiledKey& key,
                                   cv::Point origin = {40, 180},
                                   int maxLinesTotal = 70) {
     int x = origin.x;
@@ -198,10 +869,15 @@ static void drawComparisonOverlay(cv::Mat& frame,
     };
 
     int lines = 0;
+    static const AnswerVector noAnswers;
 
     for (const auto& subj : order) {
-        auto itKey = answerKeyMap.find(subj);
-        if (itKey == answerKeyMap.end()) continue;
+        int keyIdx = key.subjectIndex(subj);
+        if (keyIdx < 0) continue;
+        const AnswerKey::CompiledKey::Subject& keySubj = key.subjects[keyIdx];
+
+        auto itStudent = studentAnswers.find(subj);
+        const AnswerVector& subjAnswers = (itStudent != studentAnswers.end()) ? itStudent->second : noAnswers;
 
         cv::putText(frame, shortName(subj) + ":",
                     {x, y},
@@ -209,26 +885,29 @@ static void drawComparisonOverlay(cv::Mat& frame,
                     0.95, cv::Scalar(0, 0, 0), 3);
         y += 30;
 
-        int maxQ = -1;
-        for (const auto& qp : itKey->second) maxQ = std::max(maxQ, qp.first);
-        int totalQ = maxQ + 1;
+        int totalQ = keySubj.count;
         if (totalQ <= 0) { y += 10; continue; }
 
         for (int qi = 0; qi < totalQ; ++qi) {
             if (lines >= maxLinesTotal) return;
 
-            char correct = '-';
-            auto itC = itKey->second.find(qi);
-            if (itC != itKey->second.end()) correct = itC->second;
+            const int k = keySubj.first + qi;
+            std::string correct;
+            for (int o = 0; o < 26; ++o)
+                if ((key.accept[k] >> o) & 1u) correct.push_back(static_cast<char>('A' + o));
+            if (correct.empty()) correct = "-";
 
-            char student = getStudentAnswerAt(studentAnswersCsv, subj, qi);
+            uint8_t code = subjAnswers[qi];
+            char student = AnswerVector::toChar(code);
 
             std::string status;
             cv::Scalar color;
 
-            if (student == '-') { status = "BOS";   color = cv::Scalar(0, 0, 0); }
-            else if (student == 'X') { status = "MULTI"; color = cv::Scalar(0, 0, 255); }
-            else if (student == correct) { status = "DOGRU"; color = cv::Scalar(0, 200, 0); }
+            if (key.cancelled[k]) { status = "IPTAL"; color = cv::Scalar(0, 200, 0); }
+            else if (code == AnswerVector::Blank) { status = "BOS";   color = cv::Scalar(0, 0, 0); }
+            else if (code == AnswerVector::Multi) { status = "MULTI"; color = cv::Scalar(0, 0, 255); }
+            else if (code == AnswerVector::Uncertain) { status = "BELIRSIZ"; color = cv::Scalar(0, 140, 255); }
+            else if (key.scores(k, code)) { status = "DOGRU"; color = cv::Scalar(0, 200, 0); }
             else { status = "YANLIS"; color = cv::Scalar(0, 0, 255); }
 
             std::stringstream ss;
@@ -248,8 +927,34 @@ static void drawComparisonOverlay(cv::Mat& frame,
 }
 
 int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--serve") return runServer(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--send") return runClient(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--batch") return runBatch(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--report") return runReport(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-regions") return runBenchRegions(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-warp") return runBenchWarp(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-corners") return runBenchCorners(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-threshold") return runBenchThreshold(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-cv") return runBenchCv(argc, argv);
+
     int camIndex = 0;
-    if (argc > 1) camIndex = std::atoi(argv[1]);
+    int regionThreads = 1;
+    bool regionWarp = false;
+    bool trackMode = false;
+    bool everyFrame = false;
+    std::string keyPath = kDefaultKeyPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--region-threads" && i + 1 < argc) regionThreads = std::atoi(argv[++i]);
+        else if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else if (a == "--region-warp") regionWarp = true;
+        else if (a == "--track") trackMode = true;
+        else if (a == "--every-frame") everyFrame = true;
+        else camIndex = std::atoi(argv[i]);
+    }
+
+    AnswerKey answerKey;
+    if (!loadAnswerKey(answerKey, keyPath)) return 1;
 
     cv::VideoCapture cap(camIndex, cv::CAP_ANY);
     if (!cap.isOpened()) {
@@ -263,32 +968,32 @@ int main(int argc, char** argv) {
     cap.set(cv::CAP_PROP_FPS, 30);
     cap.set(cv::CAP_PROP_AUTOFOCUS, 1);
 
+    core::applyCvBudget(regionReadBudget(regionThreads));
+
     core::PerspectiveCorrector pc(1600, 2200);
+    enableAutoOrientation(pc);
+    pc.setRemapCache(trackMode);
 
     ROIDetector detector;
     detector.setFillThreshold(0.40);
+    detector.setRegionThreads(regionThreads);
+    if (const float* booklet = answerKey.bookletRegion()) detector.setBookletRegion(booklet);
+    const std::vector<cv::Rect> regionRects =
+        detector.regionRects(cv::Size(pc.outWidth(), pc.outHeight()));
 
-    AnswerKey answerKey;
-    std::vector<AnswerKey::QuestionAnswer> answers;
-
-    addSubjectKey(answers, "turkce",    "CBAABDBCCCCDABABCAAD");
-    addSubjectKey(answers, "sosyal",    "BBDABBACADCBAACDDCCD");
-    addSubjectKey(answers, "din",       "BABDBABDBACDBBAACBDB");
-    addSubjectKey(answers, "ingilizce", "BABDBABDBACDBBAACBDB");
-    addSubjectKey(answers, "matematik", "BABDBABDBACDBBAACBDB");
-    addSubjectKey(answers, "fen",       "BABDBABDBACDBBAACBDB");
+    const int temporalHistory = 7;
+    detector.setTemporalSmoothing(true, temporalHistory);
+    int missedFrames = 0;
 
-    answerKey.loadAnswerKey(answers);
+    core::AutoCapture autoCapture(10, 3.0, temporalHistory + 1);
+    bool autoMode = false;
 
-    std::map<std::string, std::map<int, char>> answerKeyMap;
-    for (const auto& qa : answers) {
-        answerKeyMap[qa.subject][qa.questionNumber] = qa.correctAnswer;
-    }
+    double camFps = cap.get(cv::CAP_PROP_FPS);
+    core::LiveScheduler scheduler((camFps > 1.0 && camFps < 241.0) ? 1000.0 / camFps : 1000.0 / 30.0);
 
     bool showDebug = true;
     bool showBubbleDebug = true;
     bool showCompareOverlay = true;
-    int rotationMode = 0;
 
     bool isPaused = false;
     bool recomputeScore = false;
@@ -296,7 +1001,8 @@ int main(int argc, char** argv) {
     cv::Mat currentFrame;
 
     AnswerKey::ScoreResult lastScore;
-    std::map<std::string, std::string> lastStudentAnswers;
+    ROIDetector::SheetRead lastStudentAnswers;
+    ROIDetector::SheetRead capturedRead;
     cv::Mat omrDebugImage;
     cv::Mat bubbleDebugImage;
 
@@ -305,8 +1011,7 @@ int main(int argc, char** argv) {
     cout << "D: perspective debug ac/kapat\n";
     cout << "B: bubble debug ac/kapat\n";
     cout << "C: compare overlay ac/kapat\n";
-    cout << "R: rotate\n";
-    cout << "+/-: threshold\n";
+    cout << "A: otomatik yakalama ac/kapat\n";
     cout << "ESC: cikis\n\n";
 
 
@@ -329,66 +1034,112 @@ int main(int argc, char** argv) {
             frame = currentFrame.clone();
         }
 
-        cv::Mat processedFrame = frame.clone();
-        if (rotationMode == 1) cv::rotate(frame, processedFrame, cv::ROTATE_90_CLOCKWISE);
-        else if (rotationMode == 2) cv::rotate(frame, processedFrame, cv::ROTATE_90_COUNTERCLOCKWISE);
-        else if (rotationMode == 3) cv::rotate(frame, processedFrame, cv::ROTATE_180);
-
-        auto R = pc.findAndWarp(processedFrame, showDebug);
+        auto tFrame = std::chrono::steady_clock::now();
+        double warpMs = 0.0, readMs = 0.0;
+
+        // Live frames read only as often as the frame budget allows; the
+        // frozen frame is read once when the result screen opens.
+        bool holding = autoMode && autoCapture.isHolding();
+        bool wantRead = isPaused ? recomputeScore : !holding;
+        core::LiveScheduler::Stage stage = core::LiveScheduler::Stage::Read;
+        if (!everyFrame && !(isPaused && recomputeScore)) stage = scheduler.plan(wantRead, !isPaused);
+
+        core::CornerResult C = pc.locate(frame, showDebug);
+        core::WarpResult R;
+        R.ok = C.paper_ok;
+        R.corners = C.markers_orig;
+        R.orientation = C.orientation;
+        if (showDebug) R.debug = C.debug_bgr;
+
+        if (C.paper_ok && stage != core::LiveScheduler::Stage::Corners) {
+            auto t0 = std::chrono::steady_clock::now();
+            R = regionWarp ? pc.warpRegions(frame, C, regionRects, showDebug)
+                           : pc.warp(frame, C, showDebug);
+            warpMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
 
         cv::Mat displayFrame;
         if (showDebug && !R.debug.empty()) displayFrame = R.debug.clone();
-        else displayFrame = processedFrame.clone();
-
-        if (R.ok && !R.warped.empty()) {
-            detector.setDebugMode(showBubbleDebug);
-
-            lastStudentAnswers = detector.process(R.warped, omrDebugImage);
+        else displayFrame = frame.clone();
+
+        if (R.ok) {
+            missedFrames = 0;
+
+            if (stage == core::LiveScheduler::Stage::Read && !R.warped.empty()) {
+                auto t0 = std::chrono::steady_clock::now();
+                detector.setDebugMode(showBubbleDebug);
+                lastStudentAnswers = detector.process(R.warped, omrDebugImage);
+                readMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+                bubbleDebugImage = detector.getLastDebugVisualization();
+                if (showBubbleDebug && !bubbleDebugImage.empty()) cv::imshow("Bubble Debug", bubbleDebugImage);
+                if (!omrDebugImage.empty()) cv::imshow("Form Analizi", omrDebugImage);
+            } else if (!R.warped.empty()) {
+                cv::Mat page = R.warped.clone();
+                for (const cv::Rect& r : regionRects) cv::rectangle(page, r, cv::Scalar(255, 0, 0), 2);
+                cv::imshow("Form Analizi", page);
+            }
 
-            bubbleDebugImage = detector.getLastDebugVisualization();
-            if (showBubbleDebug && !bubbleDebugImage.empty()) cv::imshow("Bubble Debug", bubbleDebugImage);
-            if (!omrDebugImage.empty()) cv::imshow("Form Analizi", omrDebugImage);
+            bool autoFired = autoMode && !isPaused &&
+                             autoCapture.update(true, R.corners, detector.isReadStable());
 
-            if (isPaused && recomputeScore) {
-                lastScore = answerKey.calculateScore(lastStudentAnswers);
+            if ((isPaused && recomputeScore && readMs > 0.0) || autoFired) {
+                capturedRead = lastStudentAnswers;
+                lastScore = answerKey.calculateScore(capturedRead.subjects,
+                                                     AnswerKey::bookletFromFields(capturedRead.fields));
                 recomputeScore = false;
             }
 
-            if (isPaused) {
+            bool showResult = isPaused || (autoMode && autoCapture.isHolding());
+
+            if (showResult) {
                 if (lastScore.totalQuestions > 0) drawScoreOverlay(displayFrame, lastScore);
 
-                drawIdentityOverlay(displayFrame, lastStudentAnswers, {40, 70});
+                drawIdentityOverlay(displayFrame, capturedRead.fields, {40, 70});
 
                 if (showCompareOverlay) {
-                    drawComparisonOverlay(displayFrame, lastStudentAnswers, answerKeyMap, {40, 220}, 70);
+                    drawComparisonOverlay(displayFrame, capturedRead.subjects,
+                                          answerKey.compiled(lastScore.booklet), {40, 220}, 70);
                 }
 
                 cv::rectangle(displayFrame, cv::Point(0, 0),
                               cv::Point(displayFrame.cols, displayFrame.rows),
                               cv::Scalar(0, 0, 255), 6);
-                cv::putText(displayFrame, "SONUC EKRANI (Canli icin P)", cv::Point(40, 40),
+                cv::putText(displayFrame,
+                            isPaused ? "SONUC EKRANI (Canli icin P)" : "OTOMATIK SONUC (Kagidi kaldirin)",
+                            cv::Point(40, 40),
                             cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 255), 2);
             } else {
-                cv::putText(displayFrame, "Hizala ve 'P' tusuna bas", cv::Point(40, 40),
-                            cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 0), 2);
+                if (detector.isReadStable()) {
+                    cv::putText(displayFrame, "OKUMA SABIT - 'P' ile yakala", cv::Point(40, 40),
+                                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 0), 2);
+                } else {
+                    cv::putText(displayFrame, "Hizala ve bekle (okuma sabitleniyor)", cv::Point(40, 40),
+                                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 200, 255), 2);
+                }
             }
 
         } else {
+            if (!isPaused && ++missedFrames > temporalHistory) detector.resetTemporalHistory();
+            if (autoMode && !isPaused) autoCapture.update(false, R.corners, false);
+
             if (isPaused) {
                 cv::putText(displayFrame, "KAGIT BULUNAMADI!", cv::Point(50, 200),
                             cv::FONT_HERSHEY_SIMPLEX, 1.5, cv::Scalar(0, 0, 255), 3);
             }
         }
 
-        string infoText;
-        if (rotationMode == 0) infoText = "Rot: OFF";
-        else if (rotationMode == 1) infoText = "Rot: 90 CW";
-        else if (rotationMode == 2) infoText = "Rot: 90 CCW";
-        else if (rotationMode == 3) infoText = "Rot: 180";
-
         std::stringstream ts;
-        ts << fixed << setprecision(2) << detector.getFillThreshold();
-        infoText += " | Hassasiyet: " + ts.str();
+        ts << fixed << setprecision(2) << lastStudentAnswers.answerThreshold
+           << (lastStudentAnswers.calibrated ? " (oto)" : " (sabit)");
+        string infoText = "Yon: " + std::to_string(R.ok ? R.orientation * 90 : 0) +
+                          " | Esik: " + ts.str();
+        if (autoMode) infoText += autoCapture.isHolding() ? " | Oto: kagidi kaldirin" : " | Oto: hazir";
+        if (!everyFrame) {
+            std::stringstream rs;
+            rs << " | Okuma: 1/" << static_cast<int>(std::lround(scheduler.readEvery())) << " kare";
+            infoText += rs.str();
+        }
 
         cv::putText(displayFrame, infoText, cv::Point(40, displayFrame.rows - 50),
                     cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 0), 2);
@@ -398,6 +1149,9 @@ int main(int argc, char** argv) {
         int k = cv::waitKey(1) & 0xFF;
         if (k == 27) break;
 
+        scheduler.record(warpMs, readMs, std::chrono::duration<double, std::milli>(
+                                             std::chrono::steady_clock::now() - tFrame).count());
+
         if (k == 'p' || k == 'P') {
             isPaused = !isPaused;
             if (isPaused) recomputeScore = true;
@@ -405,10 +1159,11 @@ int main(int argc, char** argv) {
 
         if (k == 'd' || k == 'D') showDebug = !showDebug;
 
-        if (k == 'r' || k == 'R') rotationMode = (rotationMode + 1) % 4;
+        if (k == 'a' || k == 'A') {
+            autoMode = !autoMode;
+            autoCapture.reset();
+        }
 
-        if (k == '+' || k == '=') detector.setFillThreshold(detector.getFillThreshold() + 0.05);
-        if (k == '-' || k == '_') detector.setFillThreshold(max(0.05, detector.getFillThreshold() - 0.05));
 
         if (k == 'b' || k == 'B') {
             showBubbleDebug = !showBubbleDebug;
@@ -0,0 +1,133 @@
+// processWithDetails must agree question by question with process()
+// followed by AnswerKey::calculateScore on the same sheet.
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ROIDetector.hpp"
+#include "AnswerKey.hpp"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cerr << "HATA: " << what << "\n";
+    failures++;
+}
+
+// White page with bubbles marked on every answer grid: question q of each
+// subject gets option (q % cols), every fifth row is left blank and every
+// seventh gets two marks.
+cv::Mat syntheticSheet(const ROIDetector& detector, const cv::Size& page) {
+    cv::Mat sheet(page, CV_8UC3, cv::Scalar(255, 255, 255));
+    const std::vector<std::string> subjects = {"turkce", "sosyal", "din", "ingilizce", "matematik", "fen"};
+
+    for (const auto& reg : detector.regionDefs()) {
+        if (std::find(subjects.begin(), subjects.end(), reg.name) == subjects.end()) continue;
+
+        // Same answer-area geometry as ROIDetector::regionRect.
+        double x = reg.rectPct[0] * page.width, y = reg.rectPct[1] * page.height;
+        double w = reg.rectPct[2] * page.width, h = reg.rectPct[3] * page.height;
+        x += w * 0.02; y += h * 0.02; w *= 0.96; h *= 0.96;
+        x += w * 0.19; w = w * 0.95 - w * 0.19;
+
+        const double cw = w / reg.cols, ch = h / reg.rows;
+        const int radius = static_cast<int>(std::min(cw, ch) * 0.3);
+        for (int r = 0; r < reg.rows; ++r) {
+            for (int c = 0; c < reg.cols; ++c) {
+                cv::Point centre(static_cast<int>(x + (c + 0.5) * cw), static_cast<int>(y + (r + 0.5) * ch));
+                bool marked = (r % 5 != 4) && (c == r % reg.cols || (r % 7 == 6 && c == (r + 1) % reg.cols));
+                cv::circle(sheet, centre, radius, cv::Scalar(0, 0, 0), marked ? cv::FILLED : 2);
+            }
+        }
+    }
+    return sheet;
+}
+
+AnswerKey testKey() {
+    std::vector<AnswerKey::QuestionAnswer> keys;
+    const std::string answers = "ABCDDCBAABCDDCBAABCD";
+    for (const std::string subject : {"turkce", "matematik", "fen"}) {
+        for (int q = 0; q < static_cast<int>(answers.size()); ++q) {
+            AnswerKey::QuestionAnswer qa{subject, q, answers[q]};
+            if (q == 3) qa.alsoAccepted = "A";
+            if (q == 8) qa.cancelled = true;
+            keys.push_back(qa);
+        }
+    }
+    AnswerKey key;
+    key.loadAnswerKey(keys);
+    return key;
+}
+
+}
+
+int main() {
+    const cv::Size page(1600, 2200);
+    const AnswerKey key = testKey();
+
+    ROIDetector plain;
+    ROIDetector detailed;
+    const cv::Mat sheet = syntheticSheet(plain, page);
+    cv::Mat debugOut;
+
+    ROIDetector::SheetRead read = plain.process(sheet, debugOut);
+    AnswerKey::ScoreResult score = key.calculateScore(read.subjects, AnswerKey::bookletFromFields(read.fields));
+
+    ROIDetector::SheetRead detailedRead;
+    auto details = detailed.processWithDetails(sheet, debugOut, key, &detailedRead);
+
+    expect(detailedRead.subjects.size() == read.subjects.size(), "ders sayisi farkli");
+    expect(detailedRead.answerThreshold == read.answerThreshold, "esik farkli");
+    expect(score.totalCorrect > 0 && score.totalWrong > 0, "sentetik form hem dogru hem yanlis icermeli");
+
+    size_t cellOffset = 0;
+    for (const auto& reg : plain.regionDefs()) {
+        const size_t offset = cellOffset;
+        cellOffset += static_cast<size_t>(reg.rows) * reg.cols;
+
+        auto itRow = read.subjects.find(reg.name);
+        if (itRow == read.subjects.end()) continue;
+        const AnswerVector& row = itRow->second;
+
+        auto itDet = details.find(reg.name);
+        if (itDet == details.end()) {
+            expect(false, reg.name + ": ayrinti yok");
+            continue;
+        }
+        const auto& det = itDet->second;
+        expect(static_cast<int>(det.size()) == row.size(), reg.name + ": soru sayisi farkli");
+
+        int correct = 0, wrong = 0;
+        for (int i = 0; i < row.size() && i < static_cast<int>(det.size()); ++i) {
+            const std::string at = reg.name + " soru " + std::to_string(i + 1);
+            expect(det[i].questionNumber == i, at + ": numara");
+            expect(det[i].markedAnswer == AnswerVector::toChar(row[i]), at + ": isaret farkli");
+
+            float fill = 0.0f;
+            for (int c = 0; c < reg.cols; ++c) fill = std::max(fill, read.cellFills[offset + i * reg.cols + c]);
+            expect(det[i].fillRatio == fill, at + ": doluluk farkli");
+
+            if (det[i].isCorrect) correct++;
+            else if (AnswerVector::isAnswer(row[i])) wrong++;
+        }
+
+        auto itStat = score.subjectDetails.find(reg.name);
+        if (itStat == score.subjectDetails.end()) {
+            for (const auto& d : det) expect(!d.isCorrect && d.correctAnswer == '-', reg.name + ": anahtar disi");
+            continue;
+        }
+        expect(correct == itStat->second.correct, reg.name + ": dogru sayisi farkli");
+        expect(wrong == itStat->second.wrong, reg.name + ": yanlis sayisi farkli");
+    }
+
+    if (failures) {
+        std::cerr << failures << " hata\n";
+        return 1;
+    }
+    std::cout << "processWithDetails == process + calculateScore\n";
+    return 0;
+}